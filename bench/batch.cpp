@@ -0,0 +1,81 @@
+#include <pbsl/batch.h>
+#include <pbsl/writer.h>
+#include <algorithm>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "pbsl/bench.pbsl.h"
+
+// Enough small records that they and their messages are far larger than the
+// caches
+static const size_t RecordCount = 1 << 20;
+
+// Copies the records to a buffer in random order, each in a cache line of
+// its own, so consecutive records are not next to each other in memory, like
+// in a receive ring that wrapped many times
+static std::vector<std::string_view> scatterRecords(const std::vector<std::string> &encoded, std::string &buffer)
+{
+   auto order = std::vector<size_t>(encoded.size());
+
+   for (auto i = size_t { 0 }; i < order.size(); ++i) {
+      order[i] = i;
+   }
+
+   std::shuffle(order.begin(), order.end(), std::mt19937 { 42 });
+   buffer.assign(encoded.size() * pbsl::CacheLineSize, '\0');
+
+   auto records = std::vector<std::string_view>(encoded.size());
+
+   for (auto i = size_t { 0 }; i < order.size(); ++i) {
+      auto &record = encoded[order[i]];
+      auto data = &buffer[i * pbsl::CacheLineSize];
+      std::copy(record.begin(), record.end(), data);
+      records[order[i]] = std::string_view { data, record.size() };
+   }
+
+   return records;
+}
+
+// Decodes a batch of scattered Sample records with parse() one after another
+// and with parseBatch() at a few lane counts. One lane only prefetches, more
+// lanes also interleave the decoding of their records.
+void benchBatch()
+{
+   const size_t laneCounts[] = { 1, 2, 4, 8 };
+   auto encoded = std::vector<std::string> {};
+
+   for (auto i = size_t { 0 }; i < RecordCount; ++i) {
+      encoded.push_back(pbsl::serialize(Sample { static_cast<int32_t>(i), "sample" }));
+   }
+
+   auto buffer = std::string {};
+   auto records = scatterRecords(encoded, buffer);
+   auto messages = std::vector<Sample>(RecordCount);
+
+   auto serial = measure(3, [&]() {
+      for (auto i = size_t { 0 }; i < records.size(); ++i) {
+         messages[i] = Sample {};
+         BenchSink = BenchSink + (messages[i].parse(records[i]) ? 1 : 0);
+      }
+   });
+
+   std::cout << std::fixed << std::setprecision(1);
+   std::cout << std::left << std::setw(14) << "decode" << std::right
+             << std::setw(13) << "ns/record"
+             << std::setw(10) << "speedup" << std::endl;
+   std::cout << std::left << std::setw(14) << "parse()" << std::right
+             << std::setw(13) << serial / RecordCount
+             << std::setw(9) << 1.0 << "x" << std::endl;
+
+   for (auto lanes : laneCounts) {
+      auto batch = measure(3, [&]() {
+         BenchSink = BenchSink + pbsl::parseBatch(records.data(), records.size(), messages.data(), nullptr, pbsl::DefaultPrefetchDistance, lanes);
+      });
+
+      std::cout << std::left << std::setw(8) << "batch" << std::right << std::setw(2) << lanes << " lanes"
+                << std::setw(11) << batch / RecordCount
+                << std::setw(9) << serial / batch << "x" << std::endl;
+   }
+}
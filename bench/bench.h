@@ -0,0 +1,41 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+
+// Results are added to this so the measured work is not optimised away
+extern volatile size_t BenchSink;
+
+// Returns the nanoseconds per call of function over iterations calls, the
+// best of a few rounds so other load on the machine skews results less
+template<typename Function>
+double measure(int iterations, Function function)
+{
+   using Clock = std::chrono::steady_clock;
+   static const auto Rounds = 5;
+
+   // One untimed call to warm up caches and allocators
+   function();
+
+   auto best = 0.0;
+
+   for (auto round = 0; round < Rounds; ++round) {
+      auto start = Clock::now();
+
+      for (auto i = 0; i < iterations; ++i) {
+         function();
+      }
+
+      auto time = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+      best = (round == 0) ? time : std::min(best, time);
+   }
+
+   return best;
+}
+
+void benchPrecount();
+void benchSchema();
+void benchDynamic();
+void benchPredicate();
+void benchBatch();
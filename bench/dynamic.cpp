@@ -0,0 +1,72 @@
+#include <pbsl/writer.h>
+#include <iomanip>
+#include <string>
+#include "bench.h"
+#include "dynamicmessage.h"
+#include "pbsl/bench.pbsl.h"
+
+// bench.proto is loaded from next to this file, wherever the benchmark runs
+static std::string getProtoPath()
+{
+   auto path = std::string { __FILE__ };
+   auto slash = path.find_last_of("/\\");
+   return (slash == std::string::npos ? std::string {} : path.substr(0, slash + 1)) + "bench.proto";
+}
+
+// Parses the same input with the generated parse() and with a
+// DynamicMessage of the type loaded from bench.proto, reusing one arena
+void benchDynamic()
+{
+   auto schema = pbsl::DynamicSchema {};
+   auto pointType = schema.load(getProtoPath()) ? schema.find("Point") : nullptr;
+   auto trackType = schema.find("Track");
+
+   if (!pointType || !trackType) {
+      std::cout << "Could not load " << getProtoPath() << std::endl;
+      return;
+   }
+
+   const int pointCounts[] = { 1, 16, 256 };
+   auto &points = *trackType->findField("points");
+   pbsl::Arena arena;
+
+   std::cout << std::fixed << std::setprecision(1);
+   std::cout << std::left << std::setw(19) << "message" << std::right
+             << std::setw(14) << "generated ns"
+             << std::setw(12) << "dynamic ns"
+             << std::setw(9) << "ratio" << std::endl;
+
+   for (auto count : pointCounts) {
+      auto track = Track {};
+      track.name = "track";
+
+      for (auto i = 0; i < count; ++i) {
+         auto point = Point {};
+         point.x = i * 3;
+         point.y = -i;
+         point.label = "point";
+         point.tags = { 1, 2, 300, 4000 };
+         track.points.push_back(point);
+      }
+
+      auto data = pbsl::serialize(track);
+      auto iterations = std::max(100, 200000 / count);
+
+      auto generated = measure(iterations, [&]() {
+         auto message = Track {};
+         message.parse(data);
+         BenchSink = BenchSink + message.points.size();
+      });
+
+      auto dynamic = measure(iterations, [&]() {
+         arena.reset();
+         auto message = pbsl::DynamicMessage::parse(*trackType, data, arena);
+         BenchSink = BenchSink + (message ? message->size(points) : 0);
+      });
+
+      std::cout << "track   " << std::setw(6) << count << " points"
+                << std::setw(12) << generated
+                << std::setw(12) << dynamic
+                << std::setw(8) << dynamic / generated << "x" << std::endl;
+   }
+}
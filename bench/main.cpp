@@ -0,0 +1,51 @@
+#include "bench.h"
+#include <cstring>
+
+volatile size_t BenchSink = 0;
+
+struct Benchmark
+{
+   const char *name;
+   void (*run)();
+};
+
+static const Benchmark Benchmarks[] = {
+   { "precount", &benchPrecount },
+   { "schema", &benchSchema },
+   { "dynamic", &benchDynamic },
+   { "predicate", &benchPredicate },
+   { "batch", &benchBatch },
+};
+
+// bench [name]..., runs every benchmark without names
+int main(int argc, char **argv)
+{
+   for (auto i = 1; i < argc; ++i) {
+      auto found = false;
+
+      for (auto &benchmark : Benchmarks) {
+         found = found || strcmp(argv[i], benchmark.name) == 0;
+      }
+
+      if (!found) {
+         std::cout << "Unknown benchmark " << argv[i] << std::endl;
+         return -1;
+      }
+   }
+
+   for (auto &benchmark : Benchmarks) {
+      auto selected = (argc == 1);
+
+      for (auto i = 1; i < argc; ++i) {
+         selected = selected || strcmp(argv[i], benchmark.name) == 0;
+      }
+
+      if (selected) {
+         std::cout << "[" << benchmark.name << "]" << std::endl;
+         benchmark.run();
+         std::cout << std::endl;
+      }
+   }
+
+   return 0;
+}
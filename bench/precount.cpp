@@ -0,0 +1,81 @@
+#include <pbsl/writer.h>
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "pbsl/bench.pbsl.h"
+
+enum class SampleKind
+{
+   Values,
+   Names,
+   Messages
+};
+
+static std::string encodeSamples(SampleKind kind, int count, std::vector<std::string> &names)
+{
+   auto samples = Samples {};
+   names.clear();
+
+   for (auto i = 0; i < count; ++i) {
+      names.push_back("sample " + std::to_string(i));
+   }
+
+   for (auto i = 0; i < count; ++i) {
+      switch (kind) {
+      case SampleKind::Values:
+         samples.values.push_back(i * 7);
+         break;
+      case SampleKind::Names:
+         samples.names.push_back(names[i]);
+         break;
+      case SampleKind::Messages:
+         samples.samples.push_back(Sample { i, names[i] });
+         break;
+      }
+   }
+
+   return pbsl::serialize(samples);
+}
+
+template<typename Type>
+static double measureParse(const std::string &data, int iterations)
+{
+   return measure(iterations, [&]() {
+      // A fresh message each time, reusing one would keep its capacity
+      auto message = Type {};
+      message.parse(data);
+      BenchSink = BenchSink + message.values.size() + message.names.size() + message.samples.size();
+   });
+}
+
+// Parses unpacked repeated fields of increasing length with and without the
+// pre-count pass. The pass scans the tags once more to reserve every
+// repeated field at its exact size, it pays for itself once the
+// reallocations it saves cost more than the scan, soonest for fields that
+// are expensive to move.
+void benchPrecount()
+{
+   const char *kindNames[] = { "int32", "string", "message" };
+   const int counts[] = { 1, 4, 16, 64, 256, 1024, 4096 };
+   auto names = std::vector<std::string> {};
+
+   std::cout << std::fixed << std::setprecision(1);
+   std::cout << "field     count      plain ns   precount ns   speedup" << std::endl;
+
+   for (auto kind = 0; kind < 3; ++kind) {
+      for (auto count : counts) {
+         auto data = encodeSamples(static_cast<SampleKind>(kind), count, names);
+         auto iterations = std::max(100, 400000 / count);
+         auto plain = measureParse<Samples>(data, iterations);
+         auto precounted = measureParse<PrecountedSamples>(data, iterations);
+
+         std::cout << std::left << std::setw(8) << kindNames[kind] << std::right
+                   << std::setw(7) << count
+                   << std::setw(14) << plain
+                   << std::setw(14) << precounted
+                   << std::setw(9) << plain / precounted << "x" << std::endl;
+      }
+   }
+}
@@ -0,0 +1,98 @@
+#include <pbsl/predicate.h>
+#include <pbsl/writer.h>
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "pbsl/bench.pbsl.h"
+
+static const auto RecordCount = 1000;
+static const auto GroupCount = 100;
+
+// Tracks of 16 points named "group 0" to "group 99" in turn
+static std::vector<std::string> encodeTracks()
+{
+   auto records = std::vector<std::string> {};
+
+   for (auto i = 0; i < RecordCount; ++i) {
+      auto track = Track {};
+      track.name = "group " + std::to_string(i % GroupCount);
+
+      for (auto j = 0; j < 16; ++j) {
+         auto point = Point {};
+         point.x = j;
+         point.y = -j;
+         point.label = "point";
+         point.tags.push_back(j * 100);
+         track.points.push_back(point);
+      }
+
+      records.push_back(pbsl::serialize(track));
+   }
+
+   return records;
+}
+
+// Filters tracks on their name, once by decoding every record and checking
+// the decoded name, once with a Predicate on the encoded records that only
+// decodes the records it keeps. The fewer records match, the more decoding
+// the predicate saves.
+void benchPredicate()
+{
+   const int groupCounts[] = { 1, 10, 100 };
+   auto records = encodeTracks();
+   auto views = std::vector<std::string_view>(records.begin(), records.end());
+   auto matches = std::vector<size_t>(views.size());
+
+   std::cout << std::fixed << std::setprecision(1);
+   std::cout << std::left << std::setw(10) << "selected" << std::right
+             << std::setw(16) << "decode all ns"
+             << std::setw(14) << "predicate ns"
+             << std::setw(10) << "speedup" << std::endl;
+
+   for (auto groups : groupCounts) {
+      auto names = std::vector<std::string> {};
+      auto expression = std::string { "1 in {" };
+
+      for (auto i = 0; i < groups; ++i) {
+         names.push_back("group " + std::to_string(i));
+         expression += (i ? ", \"" : "\"") + names.back() + "\"";
+      }
+
+      expression += "}";
+
+      auto predicate = pbsl::Predicate {};
+
+      if (!predicate.parse(expression)) {
+         std::cout << "Invalid predicate at " << predicate.errorPosition() << std::endl;
+         return;
+      }
+
+      auto decodeAll = measure(20, [&]() {
+         for (auto &record : views) {
+            auto track = Track {};
+            track.parse(record);
+
+            if (std::find(names.begin(), names.end(), track.name) != names.end()) {
+               BenchSink = BenchSink + track.points.size();
+            }
+         }
+      });
+
+      auto pushdown = measure(20, [&]() {
+         auto matched = predicate.select(views.data(), views.size(), matches.data());
+
+         for (auto i = size_t { 0 }; i < matched; ++i) {
+            auto track = Track {};
+            track.parse(views[matches[i]]);
+            BenchSink = BenchSink + track.points.size();
+         }
+      });
+
+      std::cout << std::setw(8) << groups << " %"
+                << std::setw(16) << decodeAll / RecordCount
+                << std::setw(14) << pushdown / RecordCount
+                << std::setw(9) << decodeAll / pushdown << "x" << std::endl;
+   }
+}
@@ -0,0 +1,110 @@
+#include <pbsl/schema.h>
+#include <pbsl/writer.h>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "pbsl/bench.pbsl.h"
+
+// Same fields as the generated Point and Track, described with a Schema
+struct PlainPoint
+{
+   int32_t x;
+   int32_t y;
+   std::string_view label;
+   std::vector<uint32_t> tags;
+};
+
+struct PlainTrack
+{
+   std::string_view name;
+   std::vector<PlainPoint> points;
+};
+
+using PointSchema = pbsl::Schema<
+   pbsl::Field<1, PBSL_MEMBER(&PlainPoint::x)>,
+   pbsl::Field<2, PBSL_MEMBER(&PlainPoint::y), pbsl::codec::Sint32>,
+   pbsl::Field<3, PBSL_MEMBER(&PlainPoint::label)>,
+   pbsl::Field<4, PBSL_MEMBER(&PlainPoint::tags)>>;
+
+using TrackSchema = pbsl::Schema<
+   pbsl::Field<1, PBSL_MEMBER(&PlainTrack::name)>,
+   pbsl::Field<2, PBSL_MEMBER(&PlainTrack::points), pbsl::codec::Repeated<pbsl::codec::Message<PointSchema>>>>;
+
+static Point makePoint(int i, int tags)
+{
+   auto point = Point {};
+   point.x = i * 3;
+   point.y = -i;
+   point.label = "point";
+
+   for (auto tag = 0; tag < tags; ++tag) {
+      point.tags.push_back(tag * 100);
+   }
+
+   return point;
+}
+
+// Parses the same input with the generated parse() and with a Schema, the
+// schema compares each tag with its fields in order where parse() switches
+void benchSchema()
+{
+   const int tagCounts[] = { 0, 4, 32 };
+   const int pointCounts[] = { 1, 16, 256 };
+
+   std::cout << std::fixed << std::setprecision(1);
+   std::cout << std::left << std::setw(19) << "message" << std::right
+             << std::setw(14) << "generated ns"
+             << std::setw(11) << "schema ns"
+             << std::setw(9) << "ratio" << std::endl;
+
+   for (auto tags : tagCounts) {
+      auto data = pbsl::serialize(makePoint(7, tags));
+
+      auto generated = measure(200000, [&]() {
+         auto point = Point {};
+         point.parse(data);
+         BenchSink = BenchSink + point.x + point.tags.size();
+      });
+
+      auto schema = measure(200000, [&]() {
+         auto point = PlainPoint {};
+         PointSchema::parse(data, point);
+         BenchSink = BenchSink + point.x + point.tags.size();
+      });
+
+      std::cout << "point   " << std::setw(6) << tags << " tags"
+                << std::setw(14) << generated
+                << std::setw(11) << schema
+                << std::setw(8) << schema / generated << "x" << std::endl;
+   }
+
+   for (auto count : pointCounts) {
+      auto track = Track {};
+      track.name = "track";
+
+      for (auto i = 0; i < count; ++i) {
+         track.points.push_back(makePoint(i, 4));
+      }
+
+      auto data = pbsl::serialize(track);
+      auto iterations = std::max(100, 200000 / count);
+
+      auto generated = measure(iterations, [&]() {
+         auto message = Track {};
+         message.parse(data);
+         BenchSink = BenchSink + message.points.size();
+      });
+
+      auto schema = measure(iterations, [&]() {
+         auto message = PlainTrack {};
+         TrackSchema::parse(data, message);
+         BenchSink = BenchSink + message.points.size();
+      });
+
+      std::cout << "track   " << std::setw(6) << count << " points"
+                << std::setw(12) << generated
+                << std::setw(11) << schema
+                << std::setw(8) << schema / generated << "x" << std::endl;
+   }
+}
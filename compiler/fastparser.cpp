@@ -0,0 +1,420 @@
+#include "parser.h"
+#include "lexer.h"
+#include "mappedfile.h"
+#include <iostream>
+
+// Recursive descent parser for .proto files, one token of lookahead and no
+// backtracking. Produces the same structs as the prs grammar in parser.cpp
+// and also accepts comments, syntax and package statements, several field
+// options and reserved or extensions ranges, which are skipped.
+class FastParser
+{
+public:
+   FastParser(const char *data, size_t size) :
+      mLexer(data, size)
+   {
+      advance();
+   }
+
+   bool parse(ProtoFile &result)
+   {
+      while (mToken.type != TokenType::End) {
+         if (mToken.is("message")) {
+            result.messages.emplace_back();
+
+            if (!parseMessage(result.messages.back())) {
+               return false;
+            }
+         } else if (mToken.is("enum")) {
+            result.enums.emplace_back();
+
+            if (!parseEnum(result.enums.back())) {
+               return false;
+            }
+         } else if (mToken.is("option")) {
+            result.options.emplace_back();
+
+            if (!parseOption(result.options.back())) {
+               return false;
+            }
+         } else if (mToken.is("import")) {
+            result.imports.emplace_back();
+
+            if (!parseImport(result.imports.back())) {
+               return false;
+            }
+         } else if (mToken.is("extend")) {
+            // Extensions are parsed but not generated
+            auto extend = Extend {};
+
+            if (!parseExtend(extend)) {
+               return false;
+            }
+         } else if (mToken.is("syntax") || mToken.is("package")) {
+            if (!skipStatement()) {
+               return false;
+            }
+         } else if (!accept(";")) {
+            return error("Expected message, enum, option, import or extend");
+         }
+      }
+
+      return true;
+   }
+
+   void printError(const std::string &path)
+   {
+      auto column = size_t { 0 };
+      auto line = mLexer.getLine(mErrorToken.text, column);
+
+      std::cout << "Syntax Error in " << path << "(" << mErrorToken.line << "): " << mError << std::endl;
+      std::cout << line << std::endl;
+      std::cout << std::string(column, ' ') << '^' << std::endl;
+   }
+
+private:
+   void advance()
+   {
+      mToken = mLexer.next();
+   }
+
+   bool accept(const char *value)
+   {
+      if (mToken.is(value)) {
+         advance();
+         return true;
+      }
+
+      return false;
+   }
+
+   bool error(const std::string &message)
+   {
+      if (mError.empty()) {
+         mError = message;
+         mErrorToken = mToken;
+      }
+
+      return false;
+   }
+
+   bool expect(const char *value)
+   {
+      if (!accept(value)) {
+         return error(std::string("Expected '") + value + "'");
+      }
+
+      return true;
+   }
+
+   bool expectSymbol(std::string &value)
+   {
+      if (mToken.type != TokenType::Symbol) {
+         return error("Expected identifier");
+      }
+
+      value = mToken.str();
+      advance();
+      return true;
+   }
+
+   bool expectNumber(std::string &value)
+   {
+      if (mToken.type != TokenType::Number) {
+         return error("Expected number");
+      }
+
+      value = mToken.str();
+      advance();
+      return true;
+   }
+
+   // number | symbol | "string", strings keep their quotes
+   bool expectValue(std::string &value)
+   {
+      if (mToken.type != TokenType::Number && mToken.type != TokenType::Symbol && mToken.type != TokenType::String) {
+         return error("Expected value");
+      }
+
+      value = mToken.str();
+      advance();
+      return true;
+   }
+
+   // Skips to and past the next ';'
+   bool skipStatement()
+   {
+      while (mToken.type != TokenType::End && !mToken.is(";")) {
+         advance();
+      }
+
+      return expect(";");
+   }
+
+   // option name = value;
+   bool parseOption(Option &option)
+   {
+      return expect("option")
+          && expectSymbol(option.name)
+          && expect("=")
+          && expectValue(option.value)
+          && expect(";");
+   }
+
+   // import [public|weak] "path";
+   bool parseImport(Import &import)
+   {
+      if (!expect("import")) {
+         return false;
+      }
+
+      if (!accept("public")) {
+         accept("weak");
+      }
+
+      if (mToken.type != TokenType::String) {
+         return error("Expected import path");
+      }
+
+      import.file = std::string(mToken.text + 1, mToken.size - 2);
+      advance();
+      return expect(";");
+   }
+
+   // [name = value, ...]
+   bool parseFieldOptions(std::vector<FieldOption> &options)
+   {
+      if (!accept("[")) {
+         return true;
+      }
+
+      do {
+         auto option = FieldOption {};
+
+         if (!expectSymbol(option.name) || !expect("=") || !expectValue(option.value)) {
+            return false;
+         }
+
+         options.push_back(std::move(option));
+      } while (accept(","));
+
+      return expect("]");
+   }
+
+   // [optional|required|repeated] type name = number [options];
+   bool parseField(Field &field)
+   {
+      if (accept("optional")) {
+         field.rule = FieldRule::Optional;
+      } else if (accept("required")) {
+         field.rule = FieldRule::Required;
+      } else if (accept("repeated")) {
+         field.rule = FieldRule::Repeated;
+      }
+
+      auto type = std::string {};
+
+      if (!expectSymbol(type)) {
+         return false;
+      }
+
+      field.type = TypeInfo::getTypeByName(type);
+
+      return expectSymbol(field.name)
+          && expect("=")
+          && expectNumber(field.value)
+          && parseFieldOptions(field.options)
+          && expect(";");
+   }
+
+   // map<key, value> name = number [options];
+   bool parseMapField(Field &field)
+   {
+      auto key = std::string {};
+      auto value = std::string {};
+
+      if (!expect("map") || !expect("<") || !expectSymbol(key) || !expect(",") || !expectSymbol(value) || !expect(">")) {
+         return false;
+      }
+
+      field.rule = FieldRule::Map;
+      field.keyType = TypeInfo::getTypeByName(key);
+      field.type = TypeInfo::getTypeByName(value);
+
+      return expectSymbol(field.name)
+          && expect("=")
+          && expectNumber(field.value)
+          && parseFieldOptions(field.options)
+          && expect(";");
+   }
+
+   // enum name { option ...; VALUE = number [options]; ... }
+   bool parseEnum(Enum &enum_)
+   {
+      if (!expect("enum") || !expectSymbol(enum_.name) || !expect("{")) {
+         return false;
+      }
+
+      while (!accept("}")) {
+         if (mToken.is("option") || mToken.is("reserved")) {
+            if (!skipStatement()) {
+               return false;
+            }
+
+            continue;
+         }
+
+         if (accept(";")) {
+            continue;
+         }
+
+         auto field = Field {};
+         field.type.basicType = Type::EnumField;
+
+         if (!expectSymbol(field.name)
+          || !expect("=")
+          || !expectValue(field.value)
+          || !parseFieldOptions(field.options)
+          || !expect(";")) {
+            return false;
+         }
+
+         enum_.fields.push_back(std::move(field));
+      }
+
+      return true;
+   }
+
+   // oneof name { field; ... }, alternatives are added to msg.fields
+   bool parseOneof(Message &msg)
+   {
+      auto oneof = Oneof {};
+      auto index = static_cast<int>(msg.oneofs.size());
+      auto alternative = 0u;
+
+      if (!expect("oneof") || !expectSymbol(oneof.name) || !expect("{")) {
+         return false;
+      }
+
+      while (!accept("}")) {
+         if (mToken.is("option")) {
+            if (!skipStatement()) {
+               return false;
+            }
+
+            continue;
+         }
+
+         auto field = Field {};
+
+         if (!parseField(field)) {
+            return false;
+         }
+
+         field.oneofIndex = index;
+         field.oneofCase = ++alternative;
+         msg.fields.push_back(std::move(field));
+      }
+
+      msg.oneofs.push_back(std::move(oneof));
+      return true;
+   }
+
+   bool parseMessage(Message &msg)
+   {
+      if (!expect("message") || !expectSymbol(msg.name) || !expect("{")) {
+         return false;
+      }
+
+      while (!accept("}")) {
+         if (mToken.type == TokenType::End) {
+            return error("Expected '}'");
+         }
+
+         if (mToken.is("message")) {
+            msg.messages.emplace_back();
+
+            if (!parseMessage(msg.messages.back())) {
+               return false;
+            }
+         } else if (mToken.is("enum")) {
+            msg.enums.emplace_back();
+
+            if (!parseEnum(msg.enums.back())) {
+               return false;
+            }
+         } else if (mToken.is("option")) {
+            msg.options.emplace_back();
+
+            if (!parseOption(msg.options.back())) {
+               return false;
+            }
+         } else if (mToken.is("oneof")) {
+            if (!parseOneof(msg)) {
+               return false;
+            }
+         } else if (mToken.is("map")) {
+            msg.fields.emplace_back();
+
+            if (!parseMapField(msg.fields.back())) {
+               return false;
+            }
+         } else if (mToken.is("reserved") || mToken.is("extensions")) {
+            if (!skipStatement()) {
+               return false;
+            }
+         } else if (!accept(";")) {
+            msg.fields.emplace_back();
+
+            if (!parseField(msg.fields.back())) {
+               return false;
+            }
+         }
+      }
+
+      return true;
+   }
+
+   // extend name { field; ... }
+   bool parseExtend(Extend &extend)
+   {
+      if (!expect("extend") || !expectSymbol(extend.name) || !expect("{")) {
+         return false;
+      }
+
+      while (!accept("}")) {
+         extend.fields.emplace_back();
+
+         if (!parseField(extend.fields.back())) {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
+private:
+   Lexer mLexer;
+   Token mToken;
+   Token mErrorToken;
+   std::string mError;
+};
+
+bool parseFileFast(std::string path, ProtoFile &result)
+{
+   auto file = MappedFile {};
+
+   if (!file.open(path)) {
+      std::cout << "Could not open " << path << " for reading" << std::endl;
+      return false;
+   }
+
+   auto parser = FastParser { file.data(), file.size() };
+
+   if (!parser.parse(result)) {
+      parser.printError(path);
+      return false;
+   }
+
+   return true;
+}
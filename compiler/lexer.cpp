@@ -0,0 +1,214 @@
+#include "lexer.h"
+#include <cstdint>
+
+enum CharClass : uint8_t
+{
+   Other,
+   Space,
+   Newline,
+   Symbol,
+   Digit,
+   Minus,
+   Quote,
+   Slash,
+   Punctuation,
+   Terminator
+};
+
+struct CharClassTable
+{
+   CharClass classes[256];
+
+   CharClassTable()
+   {
+      for (auto &charClass : classes) {
+         charClass = Other;
+      }
+
+      for (auto c = 'a'; c <= 'z'; ++c) {
+         classes[static_cast<uint8_t>(c)] = Symbol;
+      }
+
+      for (auto c = 'A'; c <= 'Z'; ++c) {
+         classes[static_cast<uint8_t>(c)] = Symbol;
+      }
+
+      for (auto c = '0'; c <= '9'; ++c) {
+         classes[static_cast<uint8_t>(c)] = Digit;
+      }
+
+      for (auto c : "_.()") {
+         classes[static_cast<uint8_t>(c)] = Symbol;
+      }
+
+      for (auto c : "{}[]<>=;,") {
+         classes[static_cast<uint8_t>(c)] = Punctuation;
+      }
+
+      classes[static_cast<uint8_t>(' ')] = Space;
+      classes[static_cast<uint8_t>('\t')] = Space;
+      classes[static_cast<uint8_t>('\r')] = Space;
+      classes[static_cast<uint8_t>('\n')] = Newline;
+      classes[static_cast<uint8_t>('-')] = Minus;
+      classes[static_cast<uint8_t>('"')] = Quote;
+      classes[static_cast<uint8_t>('\'')] = Quote;
+      classes[static_cast<uint8_t>('/')] = Slash;
+
+      // Some editors leave a trailing null, it ends the file. Set last as
+      // the loops over string literals above also visit their null.
+      classes[0] = Terminator;
+   }
+
+   CharClass operator[](char c) const
+   {
+      return classes[static_cast<uint8_t>(c)];
+   }
+};
+
+static const CharClassTable CharClasses;
+
+Lexer::Lexer(const char *data, size_t size) :
+   mData(data),
+   mEnd(data + size),
+   mPosition(data),
+   mLine(1)
+{
+}
+
+void Lexer::skipWhitespace()
+{
+   while (mPosition != mEnd) {
+      switch (CharClasses[*mPosition]) {
+      case Newline:
+         mLine++;
+         // fallthrough
+      case Space:
+         mPosition++;
+         break;
+      case Slash:
+         if (mPosition + 1 != mEnd && mPosition[1] == '/') {
+            while (mPosition != mEnd && *mPosition != '\n') {
+               mPosition++;
+            }
+         } else if (mPosition + 1 != mEnd && mPosition[1] == '*') {
+            mPosition += 2;
+
+            while (mPosition != mEnd && !(*mPosition == '*' && mPosition + 1 != mEnd && mPosition[1] == '/')) {
+               mLine += (*mPosition == '\n');
+               mPosition++;
+            }
+
+            mPosition = (mPosition == mEnd) ? mEnd : mPosition + 2;
+         } else {
+            return;
+         }
+         break;
+      default:
+         return;
+      }
+   }
+}
+
+Token Lexer::next()
+{
+   skipWhitespace();
+
+   auto start = mPosition;
+   auto token = Token { TokenType::End, start, 0, mLine };
+
+   if (mPosition == mEnd) {
+      return token;
+   }
+
+   switch (CharClasses[*mPosition]) {
+   case Terminator:
+      mPosition = mEnd;
+      return token;
+   case Minus:
+   case Digit:
+      // -?[0-9]+(.[0-9]+)?, followed by symbol characters it is a symbol like 0x1f,
+      // or -inf and -nan
+      token.type = TokenType::Number;
+      mPosition++;
+
+      while (mPosition != mEnd && CharClasses[*mPosition] == Digit) {
+         mPosition++;
+      }
+
+      if (mPosition + 1 < mEnd && *mPosition == '.' && CharClasses[mPosition[1]] == Digit) {
+         mPosition += 2;
+
+         while (mPosition != mEnd && CharClasses[*mPosition] == Digit) {
+            mPosition++;
+         }
+      }
+
+      if (mPosition == start + 1 && *start == '-') {
+         // -inf and -nan are signed constants like -1.5
+         while (mPosition != mEnd && (CharClasses[*mPosition] == Symbol || CharClasses[*mPosition] == Digit)) {
+            mPosition++;
+         }
+
+         auto size = static_cast<size_t>(mPosition - start);
+         auto isConstant = size == 4 && (std::memcmp(start, "-inf", 4) == 0 || std::memcmp(start, "-nan", 4) == 0);
+         token.type = isConstant ? TokenType::Number : TokenType::Invalid;
+      } else if (mPosition != mEnd && CharClasses[*mPosition] == Symbol) {
+         token.type = TokenType::Symbol;
+
+         while (mPosition != mEnd && (CharClasses[*mPosition] == Symbol || CharClasses[*mPosition] == Digit)) {
+            mPosition++;
+         }
+      }
+      break;
+   case Symbol:
+      token.type = TokenType::Symbol;
+
+      while (mPosition != mEnd && (CharClasses[*mPosition] == Symbol || CharClasses[*mPosition] == Digit)) {
+         mPosition++;
+      }
+      break;
+   case Quote:
+   {
+      auto quote = *mPosition++;
+      token.type = TokenType::Invalid;
+
+      while (mPosition != mEnd && *mPosition != '\n') {
+         if (*mPosition == '\\' && mPosition + 1 != mEnd) {
+            mPosition += 2;
+         } else if (*mPosition++ == quote) {
+            token.type = TokenType::String;
+            break;
+         }
+      }
+      break;
+   }
+   case Punctuation:
+      token.type = TokenType::Punctuation;
+      mPosition++;
+      break;
+   default:
+      token.type = TokenType::Invalid;
+      mPosition++;
+      break;
+   }
+
+   token.size = static_cast<size_t>(mPosition - start);
+   return token;
+}
+
+std::string Lexer::getLine(const char *position, size_t &column) const
+{
+   auto lineStart = position;
+   auto lineEnd = position;
+
+   while (lineStart != mData && lineStart[-1] != '\n') {
+      lineStart--;
+   }
+
+   while (lineEnd != mEnd && *lineEnd != '\n' && *lineEnd != '\r') {
+      lineEnd++;
+   }
+
+   column = static_cast<size_t>(position - lineStart);
+   return std::string(lineStart, lineEnd);
+}
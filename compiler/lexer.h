@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+enum class TokenType
+{
+   End,
+   Symbol,
+   Number,
+   String,
+   Punctuation,
+   Invalid
+};
+
+// Points into the lexed data, strings keep their quotes
+struct Token
+{
+   TokenType type;
+   const char *text;
+   size_t size;
+   unsigned line;
+
+   bool is(const char *value) const
+   {
+      return (type == TokenType::Symbol || type == TokenType::Punctuation)
+          && text[0] == value[0] && std::strlen(value) == size && std::memcmp(text, value, size) == 0;
+   }
+
+   std::string str() const
+   {
+      return std::string(text, size);
+   }
+};
+
+// Splits a .proto file into tokens in a single pass without backtracking.
+// Each byte is classified with one table lookup, // and /* */ comments are
+// skipped like whitespace. Symbols may contain '.', '(' and ')' so that
+// qualified names and custom options are single tokens.
+class Lexer
+{
+public:
+   Lexer(const char *data, size_t size);
+
+   Token next();
+
+   // Line containing position and the offset of position within it
+   std::string getLine(const char *position, size_t &column) const;
+
+private:
+   void skipWhitespace();
+
+private:
+   const char *mData;
+   const char *mEnd;
+   const char *mPosition;
+   unsigned mLine;
+};
@@ -1,12 +1,32 @@
 #include "parser.h"
+#include "resolver.h"
 #include <filesystem>
 #include <iostream>
 #include <cassert>
+#include <cstring>
 #include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <chrono>
 
 size_t IndentSize = 3;
 
-std::map<std::string, Type> DeclarationTypeMap;
+// Messages of the file being generated by native name
+std::map<std::string, Message *> MessageMap;
+
+// Field frequency profile, message native name -> field number or name -> count
+std::map<std::string, std::map<std::string, uint64_t>> FieldProfile;
+
+// Fields of a profiled message seen less often than this fraction of all its
+// fields are decoded out of line
+static const auto ColdFieldRatio = 0.01;
+
+// Count repeated fields in a pre-pass to reserve them exactly, set by
+// --precount and overridden per message with "option precount = ...;"
+bool PrecountRepeated = false;
+
+// Parse with the prs grammar instead of the hand written frontend, set by --prs
+bool UsePrsFrontend = false;
 
 void addIndent(std::string &indent)
 {
@@ -62,6 +82,167 @@ void dumpEnum(std::ostream &out, Enum &enum_, std::string indent)
    out << indent << "};" << std::endl;
 }
 
+std::string getOneofAlternativeType(Field &field)
+{
+   if (field.type.basicType == Type::MessagePointer) {
+      return "std::unique_ptr<" + field.nativeType + ">";
+   } else {
+      return field.nativeType;
+   }
+}
+
+void dumpOneofDeclaration(std::ostream &out, Message &msg, unsigned index, std::string indent)
+{
+   auto &oneof = msg.oneofs[index];
+   auto types = std::string {};
+
+   out << std::endl;
+   out << indent << "enum class " << oneof.nativeCaseName << " {" << std::endl;
+   addIndent(indent);
+   out << indent << "None = 0," << std::endl;
+
+   for (auto &field : msg.fields) {
+      if (field.oneofIndex == static_cast<int>(index)) {
+         out << indent << field.nativeName << " = " << field.oneofCase << "," << std::endl;
+
+         if (types.size()) {
+            types += ", ";
+         }
+
+         types += getOneofAlternativeType(field);
+      }
+   }
+
+   subIndent(indent);
+   out << indent << "};" << std::endl;
+   out << std::endl;
+
+   out << indent << "pbsl::Oneof<" << types << "> " << oneof.nativeName << ";" << std::endl;
+   out << std::endl;
+
+   out << indent << oneof.nativeCaseName << " " << oneof.nativeName << "Case() const" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+   out << indent << "return static_cast<" << oneof.nativeCaseName << ">(" << oneof.nativeName << ".which());" << std::endl;
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+   out << std::endl;
+}
+
+// Reads a field frequency profile, one "message field count" entry per line.
+// The message is its full name, the field its number or name. Lines starting
+// with # are comments.
+bool readFieldProfile(const std::string &path)
+{
+   auto file = std::ifstream { path };
+
+   if (!file.is_open()) {
+      return false;
+   }
+
+   auto line = std::string {};
+   auto lineNumber = 0u;
+
+   while (std::getline(file, line)) {
+      auto stream = std::istringstream { line };
+      auto message = std::string {};
+      auto field = std::string {};
+      auto count = uint64_t { 0 };
+      lineNumber++;
+
+      if (!(stream >> message) || message[0] == '#') {
+         continue;
+      }
+
+      if (!(stream >> field >> count)) {
+         std::cout << path << ":" << lineNumber << ": expected message, field and count" << std::endl;
+         return false;
+      }
+
+      FieldProfile[convertClassName(message)][field] += count;
+   }
+
+   return true;
+}
+
+// Boolean options are set with "option name = true;"
+template<typename OptionType>
+bool isOptionSet(const std::vector<OptionType> &options, const std::string &name, bool otherwise = false)
+{
+   for (auto &option : options) {
+      if (option.name == name) {
+         return option.value == "true";
+      }
+   }
+
+   return otherwise;
+}
+
+uint64_t getFieldCount(const std::map<std::string, uint64_t> &profile, Field &field)
+{
+   auto itr = profile.find(field.value);
+
+   if (itr == profile.end()) {
+      itr = profile.find(field.name);
+   }
+
+   return itr == profile.end() ? 0 : itr->second;
+}
+
+// Splits the fields of msg into those decoded in the main loop, hottest first,
+// and those moved out of line. Without a profile all fields are hot and keep
+// their declaration order.
+void getProfiledFields(Message &msg, std::vector<Field *> &hot, std::vector<Field *> &cold)
+{
+   auto profile = FieldProfile.find(msg.nativeName);
+
+   for (auto &field : msg.fields) {
+      hot.push_back(&field);
+   }
+
+   if (profile == FieldProfile.end()) {
+      return;
+   }
+
+   auto total = uint64_t { 0 };
+
+   for (auto field : hot) {
+      total += getFieldCount(profile->second, *field);
+   }
+
+   std::stable_sort(hot.begin(), hot.end(), [&](Field *lhs, Field *rhs) {
+         return getFieldCount(profile->second, *lhs) > getFieldCount(profile->second, *rhs);
+      });
+
+   auto isCold = [&](Field *field) {
+      return getFieldCount(profile->second, *field) < total * ColdFieldRatio;
+   };
+
+   auto split = std::stable_partition(hot.begin(), hot.end(), [&](Field *field) { return !isCold(field); });
+   cold.assign(split, hot.end());
+   hot.erase(split, hot.end());
+}
+
+void dumpParseBody(std::ostream &out, Message &msg, std::vector<Field *> &hotFields, std::vector<Field *> &coldFields, std::string indent);
+void dumpParseFieldBody(std::ostream &out, Message &msg, std::vector<Field *> &hotFields, std::vector<Field *> &coldFields, std::string indent);
+
+// Messages held through a pointer from a dependency cycle are declared first
+void dumpForwardDeclarations(std::ostream &out, std::vector<Message> &messages, std::string indent)
+{
+   auto any = false;
+
+   for (Message &msg : messages) {
+      if (msg.forwardDeclare) {
+         out << indent << "struct " << msg.name << ";" << std::endl;
+         any = true;
+      }
+   }
+
+   if (any) {
+      out << std::endl;
+   }
+}
+
 void dumpMessageDeclaration(std::ostream &out, Message &msg, std::string indent)
 {
    // Dump message struct
@@ -75,6 +256,8 @@ void dumpMessageDeclaration(std::ostream &out, Message &msg, std::string indent)
       out << std::endl;
    }
 
+   dumpForwardDeclarations(out, msg.messages, indent);
+
    // Dump child messages
    for (Message &submsg : msg.messages) {
       dumpMessageDeclaration(out, submsg, indent);
@@ -83,14 +266,24 @@ void dumpMessageDeclaration(std::ostream &out, Message &msg, std::string indent)
 
    // Dump fields
    for (Field &field : msg.fields) {
-      if (field.type.basicType == Type::MessagePointer) {
+      if (field.oneofIndex >= 0) {
+         continue;
+      } else if (field.rule == FieldRule::Map) {
+         if (field.type.basicType == Type::MessagePointer) {
+            out << indent << "pbsl::FlatMap<" << field.nativeKeyType << ", std::unique_ptr<" << field.nativeType << ">> " << field.nativeName << ";" << std::endl;
+         } else {
+            out << indent << "pbsl::FlatMap<" << field.nativeKeyType << ", " << field.nativeType << "> " << field.nativeName << ";" << std::endl;
+         }
+      } else if (field.type.basicType == Type::MessagePointer) {
          if (field.rule == FieldRule::Repeated) {
             out << indent << "std::vector<std::unique_ptr<" << field.nativeType << ">> " << field.nativeName << ";" << std::endl;
          } else {
             out << indent << "std::unique_ptr<" << field.nativeType << "> " << field.nativeName << ";" << std::endl;
          }
       } else {
-         if (field.rule == FieldRule::Repeated) {
+         if (field.packedView) {
+            out << indent << "pbsl::PackedView<" << field.nativeType << "> " << field.nativeName << ";" << std::endl;
+         } else if (field.rule == FieldRule::Repeated) {
             out << indent << "std::vector<" << field.nativeType << "> " << field.nativeName << ";" << std::endl;
          } else {
             out << indent << field.nativeType << " " << field.nativeName << ";" << std::endl;
@@ -98,17 +291,124 @@ void dumpMessageDeclaration(std::ostream &out, Message &msg, std::string indent)
       }
    }
 
-   out << indent << "bool parse(const std::string_view &data);" << std::endl;
+   // Dump oneofs
+   for (auto i = 0u; i < msg.oneofs.size(); ++i) {
+      dumpOneofDeclaration(out, msg, i, indent);
+   }
+
+   auto hotFields = std::vector<Field *> {};
+   auto coldFields = std::vector<Field *> {};
+   getProfiledFields(msg, hotFields, coldFields);
+
+   if (msg.constexprParse) {
+      // Usable in constant expressions, nothing can be moved out of line
+      hotFields.insert(hotFields.end(), coldFields.begin(), coldFields.end());
+      coldFields.clear();
+
+      out << std::endl;
+      out << indent << "PBSL_CONSTEXPR bool parse(const std::string_view &data__)" << std::endl;
+      out << indent << "{" << std::endl;
+      addIndent(indent);
+      dumpParseBody(out, msg, hotFields, coldFields, indent);
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+      out << std::endl;
+      out << indent << "PBSL_CONSTEXPR bool parseField(pbsl::Parser &parser__)" << std::endl;
+      out << indent << "{" << std::endl;
+      addIndent(indent);
+      dumpParseFieldBody(out, msg, hotFields, coldFields, indent);
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+      out << std::endl;
+   } else {
+      out << indent << "bool parse(const std::string_view &data);" << std::endl;
+      out << indent << "bool parseField(pbsl::Parser &parser);" << std::endl;
+   }
+
+   if (coldFields.size()) {
+      out << indent << "bool parseCold__(pbsl::Parser &parser, unsigned field, unsigned type);" << std::endl;
+   }
+
+   out << indent << "bool parseOwned(const std::string_view &data, pbsl::StringPool &pool);" << std::endl;
+   out << indent << "size_t stringPoolSize() const;" << std::endl;
+   out << indent << "void relocateStrings(pbsl::StringPool &pool);" << std::endl;
+   out << indent << "bool applyDelta(const std::string_view &data);" << std::endl;
+   out << indent << "template<typename Visitor>" << std::endl;
+   out << indent << "static pbsl::VisitResult visit(const std::string_view &data, Visitor &visitor);" << std::endl;
+   out << indent << "static void diff(const " << msg.name << " &from, const " << msg.name << " &to, pbsl::Writer &writer);" << std::endl;
+   out << indent << "size_t byteSize() const;" << std::endl;
+   out << indent << "void serialize(pbsl::Writer &writer) const;" << std::endl;
+   out << indent << "void serializeCached(pbsl::Writer &writer) const;" << std::endl;
+   out << indent << "uint64_t hash() const;" << std::endl;
+   out << indent << "bool operator==(const " << msg.name << " &other) const;" << std::endl;
+   out << std::endl;
+   out << indent << "bool operator!=(const " << msg.name << " &other) const" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+   out << indent << "return !(*this == other);" << std::endl;
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+   out << std::endl;
+
+   // constexpr_parse messages may be constants in read only memory, they
+   // recompute their size instead of caching it
+   out << indent << "size_t cachedByteSize() const" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+   out << indent << "return " << (msg.constexprParse ? "byteSize()" : "cachedSize__.value") << ";" << std::endl;
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+
+   if (!msg.constexprParse) {
+      out << std::endl;
+      out << indent << "mutable pbsl::CachedSize cachedSize__;" << std::endl;
+   }
+
    subIndent(indent);
    out << indent << "};" << std::endl;
 }
 
+bool hasConstexprParse(Message &msg)
+{
+   return msg.constexprParse || std::any_of(msg.messages.begin(), msg.messages.end(), hasConstexprParse);
+}
+
+bool hasConstexprUtf8Check(Message &msg)
+{
+   auto validated = std::any_of(msg.fields.begin(), msg.fields.end(), [](Field &field) { return field.validateUtf8; });
+   return (msg.constexprParse && validated) || std::any_of(msg.messages.begin(), msg.messages.end(), hasConstexprUtf8Check);
+}
+
+bool hasUtf8Check(Message &msg)
+{
+   auto validated = std::any_of(msg.fields.begin(), msg.fields.end(), [](Field &field) { return field.validateUtf8; });
+   return validated || std::any_of(msg.messages.begin(), msg.messages.end(), hasUtf8Check);
+}
+
+bool hasInternedStrings(Message &msg)
+{
+   auto interned = std::any_of(msg.fields.begin(), msg.fields.end(), [](Field &field) { return field.intern; });
+   return interned || std::any_of(msg.messages.begin(), msg.messages.end(), hasInternedStrings);
+}
+
 void dumpHeaderFile(ProtoFile &proto)
 {
    std::ofstream out("pbsl/" + proto.name + ".pbsl.h");
    out << "#pragma once" << std::endl;
    out << "#include <pbsl/declaration.h>" << std::endl;
 
+   if (std::any_of(proto.messages.begin(), proto.messages.end(), hasConstexprParse)) {
+      out << "#include <pbsl/parser.h>" << std::endl;
+   }
+
+   if (std::any_of(proto.messages.begin(), proto.messages.end(), hasConstexprUtf8Check)) {
+      out << "#include <pbsl/utf8.h>" << std::endl;
+   }
+
+   if (std::any_of(proto.messages.begin(), proto.messages.end(), hasInternedStrings)) {
+      out << "#include <pbsl/intern.h>" << std::endl;
+   }
+
    // Dump imports as #include
    for (Import &import : proto.imports) {
       if (import.file.find("google") != std::string::npos) {
@@ -127,6 +427,8 @@ void dumpHeaderFile(ProtoFile &proto)
       out << std::endl;
    }
 
+   dumpForwardDeclarations(out, proto.messages, "");
+
    // Dump messages
    for (Message &msg : proto.messages) {
       dumpMessageDeclaration(out, msg, "");
@@ -136,306 +438,1986 @@ void dumpHeaderFile(ProtoFile &proto)
    out.close();
 }
 
-void dumpMessageParser(std::ostream &out, Message &msg, std::string indent)
+static const std::map<Type, std::string> ReadTypeMap = {
+   { Type::Double, "readDouble" },
+   { Type::Float, "readFloat" },
+   { Type::Int32, "readInt32" },
+   { Type::Int64, "readInt64" },
+   { Type::Uint32, "readUint32" },
+   { Type::Uint64, "readUint64" },
+   { Type::Sint32, "readSint32" },
+   { Type::Sint64, "readSint64" },
+   { Type::Fixed32, "readFixed32" },
+   { Type::Fixed64, "readFixed64" },
+   { Type::Sfixed32, "readSfixed32" },
+   { Type::Sfixed64, "readSfixed64" },
+   { Type::Bool, "readBool" },
+   { Type::String, "readString" },
+   { Type::Bytes, "readBytes" }
+};
+
+// Condition that is true when the string expr is valid UTF-8, constexpr_parse
+// messages are limited to the scalar check usable in constant expressions
+std::string getUtf8Check(Message &msg, const std::string &expr)
 {
-   static const std::map<Type, std::string> ReadTypeMap = {
-      { Type::Double, "readDouble" },
-      { Type::Float, "readFloat" },
-      { Type::Int32, "readInt32" },
-      { Type::Int64, "readInt64" },
-      { Type::Uint32, "readUint32" },
-      { Type::Uint64, "readUint64" },
-      { Type::Sint32, "readSint32" },
-      { Type::Sint64, "readSint64" },
-      { Type::Fixed32, "readFixed32" },
-      { Type::Fixed64, "readFixed64" },
-      { Type::Sfixed32, "readSfixed32" },
-      { Type::Sfixed64, "readSfixed64" },
-      { Type::Bool, "readBool" },
-      { Type::String, "readString" },
-      { Type::Bytes, "readBytes" }
-   };
+   if (msg.constexprParse) {
+      return "pbsl::isValidUtf8Scalar(" + expr + ".data(), " + expr + ".size())";
+   }
 
-   for (Message &submsg : msg.messages) {
-      dumpMessageParser(out, submsg, "");
-      out << std::endl;
+   return "pbsl::isValidUtf8(" + expr + ")";
+}
+
+// failure is what the decoding function returns for invalid strings
+void dumpUtf8Check(std::ostream &out, Message &msg, const std::string &expr, std::string indent, const char *failure = "false")
+{
+   out << std::endl;
+   out << indent << "if (PBSL_UNLIKELY(!" << getUtf8Check(msg, expr) << ")) {" << std::endl;
+   addIndent(indent);
+   out << indent << "return " << failure << ";" << std::endl;
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+}
+
+// Messages from imported files are not read, their options are unknown so
+// their parse() is assumed to fail
+bool canFailParse(Field &field)
+{
+   auto itr = MessageMap.find(field.nativeAbsoluteType);
+   return itr == MessageMap.end() || itr->second->parseCanFail;
+}
+
+// Decodes a sub message, failures of messages whose parse() can fail are
+// passed on to the parent
+void dumpSubmessageCall(std::ostream &out, Field &field, const std::string &call, std::string indent)
+{
+   if (canFailParse(field)) {
+      out << indent << "if (PBSL_UNLIKELY(!" << call << ")) {" << std::endl;
+      addIndent(indent);
+      out << indent << "return false;" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else {
+      out << indent << call << ";" << std::endl;
    }
+}
 
-   out << indent << "bool " << msg.nativeName << "::parse(const std::string_view &data__)" << std::endl;
+// Counts how often each of fields occurs in data__ so their storage can be
+// reserved up front, values are skipped using only their wire type.
+void dumpFieldCounter(std::ostream &out, std::vector<Field *> &fields, std::string indent)
+{
    out << indent << "{" << std::endl;
    addIndent(indent);
-   if (msg.fields.size() == 0) {
-      out << indent << "return true;" << std::endl;
-   } else {
-      out << indent << "auto parser__ = pbsl::Parser { data__ };" << std::endl;
+   {
+      out << indent << "auto counter__ = pbsl::Parser { data__ };" << std::endl;
+      out << indent << "size_t counts__[" << fields.size() << "] = {};" << std::endl;
       out << std::endl;
-
-      out << indent << "while(!parser__.eof()) {" << std::endl;
+      out << indent << "while (!counter__.eof()) {" << std::endl;
       addIndent(indent);
       {
-         out << indent << "auto tag__ = parser__.readTag();" << std::endl;
+         out << indent << "auto tag__ = counter__.readTag();" << std::endl;
          out << std::endl;
-         out << indent << "switch(tag__.field) {" << std::endl;
+         out << indent << "switch (tag__.field) {" << std::endl;
 
-         for (auto &field : msg.fields) {
-            out << indent << "case " << field.value << ":" << std::endl;
+         for (auto i = 0u; i < fields.size(); ++i) {
+            out << indent << "case " << fields[i]->value << ":" << std::endl;
             addIndent(indent);
-            out << indent << "assert(tag__.type == pbsl::Parser::WireType::" << getWireTypeName(field.type) << ");" << std::endl;
-
-            auto readItr = ReadTypeMap.find(field.type.basicType);
-            if (readItr == ReadTypeMap.end()) {
-               if (field.type.basicType == Type::Message) {
-                  if (field.rule == FieldRule::Repeated) {
-                     out << indent << field.nativeName << ".emplace_back();" << std::endl;
-                     out << indent << field.nativeName << ".back().parse(parser__.readString());" << std::endl;
-                  } else {
-                     out << indent << field.nativeName << ".parse(parser__.readString());" << std::endl;
-                  }
-               } else if (field.type.basicType == Type::MessagePointer) {
-                  if (field.rule == FieldRule::Repeated) {
-                     out << indent << field.nativeName << ".emplace_back(new " << field.nativeAbsoluteType << "()); " << std::endl;
-                     out << indent << field.nativeName << ".back()->parse(parser__.readString());" << std::endl;
-                  } else {
-                     out << indent << field.nativeName << " = std::make_unique<" << field.nativeAbsoluteType << ">();" << std::endl;
-                     out << indent << field.nativeName << "->parse(parser__.readString());" << std::endl;
-                  }
-               } else if (field.type.basicType == Type::Enum) {
-                  if (field.rule == FieldRule::Repeated) {
-                     out << indent << field.nativeName << ".push_back(static_cast<" << field.nativeType << ">(parser__.readUint32()));" << std::endl;
-                  } else {
-                     out << indent << field.nativeName << " = static_cast<" << field.nativeType << ">(parser__.readUint32());" << std::endl;
-                  }
-               } else {
-                  assert(false);
-               }
-            } else {
-               if (field.rule == FieldRule::Repeated) {
-                  out << indent << field.nativeName << ".push_back(parser__." << readItr->second << "());" << std::endl;
-               } else {
-                  out << indent << field.nativeName << " = parser__." << readItr->second << "();" << std::endl;
-               }
-            }
-
+            out << indent << "++counts__[" << i << "];" << std::endl;
             out << indent << "break;" << std::endl;
             subIndent(indent);
          }
 
-         out << indent << "default:" << std::endl;
-         addIndent(indent);
-         {
-            out << indent << "if (!parser__.eof()) {" << std::endl;
-            addIndent(indent);
-            {
-               out << indent << "assert(0 && \"Invalid field number!\");" << std::endl;
-            }
-            subIndent(indent);
-            out << indent << "}" << std::endl;
-            out << indent << "return false;" << std::endl;
-         }
-         subIndent(indent);
          out << indent << "}" << std::endl;
+         out << std::endl;
+         out << indent << "counter__.skipField(tag__.type);" << std::endl;
       }
       subIndent(indent);
       out << indent << "}" << std::endl;
-
       out << std::endl;
-      out << indent << "return true;" << std::endl;
+
+      for (auto i = 0u; i < fields.size(); ++i) {
+         out << indent << fields[i]->nativeName << ".reserve(" << fields[i]->nativeName << ".size() + counts__[" << i << "]);" << std::endl;
+      }
    }
    subIndent(indent);
-   out << indent << "};" << std::endl;
+   out << indent << "}" << std::endl;
+   out << std::endl;
 }
 
-void dumpSourceFile(ProtoFile &proto)
+// Map entries are encoded as a message with the key as field 1 and the value
+// as field 2, decodes them into key__ and value__ with messages left encoded
+void dumpMapEntryDecoder(std::ostream &out, Message &msg, Field &field, std::string indent, const char *failure = "false")
 {
-   if (proto.messages.size() == 0) {
-      return;
-   }
+   auto keyRead = ReadTypeMap.find(field.keyType.basicType);
+   assert(keyRead != ReadTypeMap.end());
 
-   std::ofstream out("pbsl/" + proto.name + ".pbsl.cpp");
-   out << "#include \"" + proto.name + ".pbsl.h\"" << std::endl;
-   out << "#include <pbsl/parser.h>" << std::endl;
-   out << std::endl;
+   out << indent << "auto entry__ = pbsl::Parser { parser__.readMessage() };" << std::endl;
+   out << indent << "auto key__ = " << field.nativeKeyType << " {};" << std::endl;
 
-   // Dump messages
-   for (Message &msg : proto.messages) {
-      dumpMessageParser(out, msg, "");
-      out << std::endl;
+   if (field.type.basicType == Type::Message || field.type.basicType == Type::MessagePointer) {
+      out << indent << "auto value__ = std::string_view {};" << std::endl;
+   } else {
+      out << indent << "auto value__ = " << field.nativeType << " {};" << std::endl;
    }
 
-   out.close();
-}
+   out << std::endl;
+   out << indent << "while (!entry__.eof()) {" << std::endl;
+   addIndent(indent);
+   {
+      out << indent << "auto entryTag__ = entry__.readTag();" << std::endl;
+      out << std::endl;
+      out << indent << "if (entryTag__.field == 1) {" << std::endl;
+      addIndent(indent);
+      out << indent << "key__ = entry__." << keyRead->second << "();" << std::endl;
+      subIndent(indent);
+      out << indent << "} else if (entryTag__.field == 2) {" << std::endl;
+      addIndent(indent);
 
-std::string convertClassName(const std::string &in)
-{
-   std::string nativeClass = in;
-   std::string::size_type pos;
+      auto valueRead = ReadTypeMap.find(field.type.basicType);
+      if (valueRead != ReadTypeMap.end()) {
+         out << indent << "value__ = entry__." << valueRead->second << "();" << std::endl;
+      } else if (field.type.basicType == Type::Enum) {
+         out << indent << "value__ = static_cast<" << field.nativeType << ">(entry__.readUint32());" << std::endl;
+      } else {
+         out << indent << "value__ = entry__.readMessage();" << std::endl;
+      }
 
-   if (nativeClass.at(0) == '.') {
-      nativeClass.erase(0, 1);
+      subIndent(indent);
+      out << indent << "} else {" << std::endl;
+      addIndent(indent);
+      out << indent << "entry__.skipField(entryTag__.type);" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
    }
+   subIndent(indent);
+   out << indent << "}" << std::endl;
 
-   while ((pos = nativeClass.find_first_of('.')) != std::string::npos) {
-      nativeClass.replace(pos, 1, "::", 2);
+   if (field.validateUtf8 && field.keyType.basicType == Type::String) {
+      dumpUtf8Check(out, msg, "key__", indent, failure);
    }
 
-   return nativeClass;
+   if (field.validateUtf8 && field.type.basicType == Type::String) {
+      dumpUtf8Check(out, msg, "value__", indent, failure);
+   }
 }
 
-static std::vector<std::string> RestrictedWords = {
-   "template"
-};
-
-static const std::map<Type, std::string> NativeTypeMap = {
-   { Type::Double, "double" },
-   { Type::Float, "float" },
-   { Type::Int32, "int32_t" },
-   { Type::Int64, "int64_t" },
-   { Type::Uint32, "uint32_t" },
-   { Type::Uint64, "uint64_t" },
-   { Type::Sint32, "int32_t" },
-   { Type::Sint64, "int64_t" },
-   { Type::Fixed32, "uint32_t" },
-   { Type::Fixed64, "uint64_t" },
-   { Type::Sfixed32, "int32_t" },
-   { Type::Sfixed64, "int64_t" },
-   { Type::Bool, "bool" },
-   { Type::String, "std::string_view" },
-   { Type::Bytes, "std::string_view" }
-};
-
-void createNativeNames(Enum &enum_, std::string path = "")
+void dumpMapFieldParser(std::ostream &out, Message &msg, Field &field, bool delta, std::string indent)
 {
-   enum_.nativeName = path + enum_.name;
-   DeclarationTypeMap[enum_.nativeName] = Type::Enum;
-   path += enum_.name + "::";
+   auto method = delta ? "applyDelta" : "parse";
 
-   for (auto &field : enum_.fields) {
-      if (std::find(RestrictedWords.begin(), RestrictedWords.end(), field.name) != RestrictedWords.end()) {
-         field.nativeName = field.name + "_";
-      } else {
-         field.nativeName = field.name;
-      }
+   dumpMapEntryDecoder(out, msg, field, indent);
+   out << std::endl;
+
+   // A repeated key replaces the previous entry
+   if (field.type.basicType == Type::Message) {
+      out << indent << "auto &mapped__ = " << field.nativeName << "[key__];" << std::endl;
+      out << indent << "mapped__ = " << field.nativeAbsoluteType << " {};" << std::endl;
+      dumpSubmessageCall(out, field, std::string("mapped__.") + method + "(value__)", indent);
+   } else if (field.type.basicType == Type::MessagePointer) {
+      out << indent << "auto &mapped__ = " << field.nativeName << "[key__];" << std::endl;
+      out << indent << "mapped__ = std::make_unique<" << field.nativeAbsoluteType << ">();" << std::endl;
+      dumpSubmessageCall(out, field, std::string("mapped__->") + method + "(value__)", indent);
+   } else {
+      out << indent << field.nativeName << "[key__] = value__;" << std::endl;
    }
 }
 
-void createNativeNames(Message &msg, std::string path = "")
+// Constructs the alternative in place inside the oneof's storage
+void dumpOneofFieldParser(std::ostream &out, Message &msg, Field &field, bool delta, std::string indent)
 {
-   msg.nativeName = path + msg.name;
-   DeclarationTypeMap[msg.nativeName] = Type::Message;
-   path += msg.name + "::";
-
-   for (auto &field : msg.fields) {
-      if (std::find(RestrictedWords.begin(), RestrictedWords.end(), field.name) != RestrictedWords.end()) {
-         field.nativeName = field.name + "_";
-      } else {
-         field.nativeName = field.name;
-      }
+   auto &oneof = msg.oneofs[field.oneofIndex];
+   auto alternative = std::to_string(field.oneofCase);
+   auto emplace = oneof.nativeName + ".emplace<" + alternative + ">";
+   auto readItr = ReadTypeMap.find(field.type.basicType);
+   auto isMessage = field.type.basicType == Type::Message || field.type.basicType == Type::MessagePointer;
 
-      auto typeItr = NativeTypeMap.find(field.type.basicType);
+   if (delta && isMessage) {
+      // A delta is merged into the current alternative when it is already set
+      auto get = oneof.nativeName + ".get<" + alternative + ">()";
 
-      if (typeItr != NativeTypeMap.end()) {
-         field.nativeType = typeItr->second;
+      if (field.type.basicType == Type::MessagePointer) {
+         out << indent << "if (" << oneof.nativeName << ".which() != " << alternative << " || !" << get << ") {" << std::endl;
+         addIndent(indent);
+         out << indent << emplace << "(std::make_unique<" << field.nativeAbsoluteType << ">());" << std::endl;
+         subIndent(indent);
+         out << indent << "}" << std::endl;
+         out << std::endl;
+         dumpSubmessageCall(out, field, get + "->applyDelta(parser__.readMessage())", indent);
       } else {
-         field.nativeAbsoluteType = convertClassName(field.type.className);
-         field.nativeType = field.nativeAbsoluteType;
+         out << indent << "if (" << oneof.nativeName << ".which() != " << alternative << ") {" << std::endl;
+         addIndent(indent);
+         out << indent << emplace << "();" << std::endl;
+         subIndent(indent);
+         out << indent << "}" << std::endl;
+         out << std::endl;
+         dumpSubmessageCall(out, field, get + ".applyDelta(parser__.readMessage())", indent);
+      }
+   } else if (readItr != ReadTypeMap.end()) {
+      out << indent << emplace << "(parser__." << readItr->second << "());" << std::endl;
 
-         if (field.nativeType.find(path) == 0) {
-            field.nativeType.erase(0, path.size());
-         }
+      if (field.validateUtf8) {
+         dumpUtf8Check(out, msg, oneof.nativeName + ".get<" + alternative + ">()", indent);
       }
+   } else if (field.type.basicType == Type::Enum) {
+      out << indent << emplace << "(static_cast<" << field.nativeType << ">(parser__.readUint32()));" << std::endl;
+   } else if (field.type.basicType == Type::Message) {
+      dumpSubmessageCall(out, field, emplace + "().parse(parser__.readMessage())", indent);
+   } else if (field.type.basicType == Type::MessagePointer) {
+      dumpSubmessageCall(out, field, emplace + "(std::make_unique<" + field.nativeAbsoluteType + ">())->parse(parser__.readMessage())", indent);
+   } else {
+      assert(false);
    }
+}
 
-   for (auto &enum_ : msg.enums) {
-      createNativeNames(enum_, path);
+// Dumps the case label and decoding of one field. When delta is set the
+// sub messages are merged with applyDelta() instead of parse().
+void dumpFieldParser(std::ostream &out, Message &msg, Field &field, bool delta, std::string indent)
+{
+   auto method = delta ? "applyDelta" : "parse";
+
+   if (field.rule == FieldRule::Map) {
+      out << indent << "case " << field.value << ":" << std::endl;
+      out << indent << "{" << std::endl;
+      addIndent(indent);
+      out << indent << "assert(tag__.type == pbsl::Parser::WireType::LengthDelimited);" << std::endl;
+      dumpMapFieldParser(out, msg, field, delta, indent);
+      out << indent << "break;" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+      return;
+   }
+
+   if (field.packedView) {
+      // The packed payload is viewed in place, unpacked elements or a payload
+      // split over several records could only be decoded by copying. A view
+      // left set by an earlier parse() looks like a split payload too, so
+      // messages with views must be reset before they are parsed again.
+      out << indent << "case " << field.value << ":" << std::endl;
+      addIndent(indent);
+      out << indent << "if (PBSL_UNLIKELY(tag__.type != pbsl::Parser::WireType::LengthDelimited || !" << field.nativeName << ".empty()"
+          << " || !" << field.nativeName << ".assign(parser__.readBytes()))) {" << std::endl;
+      addIndent(indent);
+      out << indent << "return false;" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+      out << indent << "break;" << std::endl;
+      subIndent(indent);
+      return;
+   }
+
+   out << indent << "case " << field.value << ":" << std::endl;
+   addIndent(indent);
+   out << indent << "assert(tag__.type == pbsl::Parser::WireType::" << getWireTypeName(field.type) << ");" << std::endl;
+
+   auto readItr = ReadTypeMap.find(field.type.basicType);
+   if (field.oneofIndex >= 0) {
+      dumpOneofFieldParser(out, msg, field, delta, indent);
+   } else if (readItr == ReadTypeMap.end()) {
+      if (field.type.basicType == Type::Message) {
+         if (field.rule == FieldRule::Repeated) {
+            out << indent << field.nativeName << ".emplace_back();" << std::endl;
+            dumpSubmessageCall(out, field, field.nativeName + ".back()." + method + "(parser__.readString())", indent);
+         } else {
+            dumpSubmessageCall(out, field, field.nativeName + "." + method + "(parser__.readString())", indent);
+         }
+      } else if (field.type.basicType == Type::MessagePointer) {
+         if (field.rule == FieldRule::Repeated) {
+            out << indent << field.nativeName << ".emplace_back(new " << field.nativeAbsoluteType << "()); " << std::endl;
+            dumpSubmessageCall(out, field, field.nativeName + ".back()->" + method + "(parser__.readString())", indent);
+         } else if (delta) {
+            out << indent << "if (!" << field.nativeName << ") {" << std::endl;
+            addIndent(indent);
+            out << indent << field.nativeName << " = std::make_unique<" << field.nativeAbsoluteType << ">();" << std::endl;
+            subIndent(indent);
+            out << indent << "}" << std::endl;
+            out << std::endl;
+            dumpSubmessageCall(out, field, field.nativeName + "->" + method + "(parser__.readString())", indent);
+         } else {
+            out << indent << field.nativeName << " = std::make_unique<" << field.nativeAbsoluteType << ">();" << std::endl;
+            dumpSubmessageCall(out, field, field.nativeName + "->" + method + "(parser__.readString())", indent);
+         }
+      } else if (field.type.basicType == Type::Enum) {
+         if (field.rule == FieldRule::Repeated) {
+            out << indent << field.nativeName << ".push_back(static_cast<" << field.nativeType << ">(parser__.readUint32()));" << std::endl;
+         } else {
+            out << indent << field.nativeName << " = static_cast<" << field.nativeType << ">(parser__.readUint32());" << std::endl;
+         }
+      } else {
+         assert(false);
+      }
+   } else {
+      auto read = "parser__." + readItr->second + "()";
+
+      if (field.intern) {
+         read = "pbsl::intern(" + read + ")";
+      }
+
+      if (field.rule == FieldRule::Repeated) {
+         out << indent << field.nativeName << ".push_back(" << read << ");" << std::endl;
+      } else {
+         out << indent << field.nativeName << " = " << read << ";" << std::endl;
+      }
+
+      if (field.validateUtf8) {
+         dumpUtf8Check(out, msg, field.rule == FieldRule::Repeated ? field.nativeName + ".back()" : field.nativeName, indent);
+      }
+   }
+
+   out << indent << "break;" << std::endl;
+   subIndent(indent);
+}
+
+// Dumps the switch decoding the field of tag__, cold fields are decoded by
+// parseCold__()
+void dumpFieldSwitch(std::ostream &out, Message &msg, std::vector<Field *> &hotFields, std::vector<Field *> &coldFields, std::string indent)
+{
+   out << indent << "switch(tag__.field) {" << std::endl;
+
+   for (auto field : hotFields) {
+      dumpFieldParser(out, msg, *field, false, indent);
+   }
+
+   out << indent << "default:" << std::endl;
+   addIndent(indent);
+
+   if (coldFields.size()) {
+      out << indent << "if (PBSL_UNLIKELY(!parseCold__(parser__, tag__.field, tag__.type))) {" << std::endl;
+      addIndent(indent);
+      out << indent << "return false;" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+      out << indent << "break;" << std::endl;
+   } else {
+      out << indent << "if (!parser__.eof()) {" << std::endl;
+      addIndent(indent);
+      {
+         out << indent << "assert(0 && \"Invalid field number!\");" << std::endl;
+      }
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+      out << indent << "return false;" << std::endl;
+   }
+
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+}
+
+// Dumps the statements of parse(), a loop over the fields of data__
+void dumpParseBody(std::ostream &out, Message &msg, std::vector<Field *> &hotFields, std::vector<Field *> &coldFields, std::string indent)
+{
+   if (msg.fields.size() == 0) {
+      out << indent << "return true;" << std::endl;
+   } else {
+      auto countedFields = std::vector<Field *> {};
+      auto precount = isOptionSet(msg.options, "precount", PrecountRepeated);
+
+      for (auto &field : msg.fields) {
+         if (field.rule == FieldRule::Map || (precount && field.rule == FieldRule::Repeated && !field.packedView)) {
+            countedFields.push_back(&field);
+         }
+      }
+
+      // Pre-size maps so decoding never has to rehash, and with precount
+      // repeated fields so they are allocated once at their exact size
+      if (countedFields.size()) {
+         dumpFieldCounter(out, countedFields, indent);
+      }
+
+      out << indent << "auto parser__ = pbsl::Parser { data__ };" << std::endl;
+      out << std::endl;
+
+      out << indent << "while(!parser__.eof()) {" << std::endl;
+      addIndent(indent);
+      {
+         out << indent << "auto tag__ = parser__.readTag();" << std::endl;
+         out << std::endl;
+         dumpFieldSwitch(out, msg, hotFields, coldFields, indent);
+      }
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+
+      out << std::endl;
+      out << indent << "return true;" << std::endl;
+   }
+}
+
+// Dumps the statements of parseField(), which decodes one field of a parser
+// owned by the caller so parseBatch() can step several messages in turn
+void dumpParseFieldBody(std::ostream &out, Message &msg, std::vector<Field *> &hotFields, std::vector<Field *> &coldFields, std::string indent)
+{
+   out << indent << "auto tag__ = parser__.readTag();" << std::endl;
+
+   if (msg.fields.size() == 0) {
+      // Like parse(), which accepts anything for a message without fields
+      out << indent << "parser__.skipField(tag__.type);" << std::endl;
+   } else {
+      out << std::endl;
+      dumpFieldSwitch(out, msg, hotFields, coldFields, indent);
+   }
+
+   out << std::endl;
+   out << indent << "return true;" << std::endl;
+}
+
+void dumpFieldVisitor(std::ostream &out, Message &msg, Field &field, std::string indent)
+{
+   auto hook = "visitor__.template onField<" + msg.nativeName + ", " + field.value + ">";
+   auto readItr = ReadTypeMap.find(field.type.basicType);
+
+   if (field.rule == FieldRule::Map) {
+      out << indent << "case " << field.value << ":" << std::endl;
+      out << indent << "{" << std::endl;
+      addIndent(indent);
+      out << indent << "assert(tag__.type == pbsl::Parser::WireType::LengthDelimited);" << std::endl;
+      dumpMapEntryDecoder(out, msg, field, indent, "pbsl::VisitResult::Failed");
+      out << std::endl;
+      out << indent << "visit__ = " << hook << "(key__, value__);" << std::endl;
+      out << indent << "break;" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else if (field.packedView) {
+      out << indent << "case " << field.value << ":" << std::endl;
+      out << indent << "{" << std::endl;
+      addIndent(indent);
+      out << indent << "auto view__ = pbsl::PackedView<" << field.nativeType << "> {};" << std::endl;
+      out << std::endl;
+      out << indent << "if (PBSL_UNLIKELY(tag__.type != pbsl::Parser::WireType::LengthDelimited || !view__.assign(parser__.readBytes()))) {" << std::endl;
+      addIndent(indent);
+      out << indent << "return pbsl::VisitResult::Failed;" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+      out << std::endl;
+      out << indent << "visit__ = " << hook << "(view__);" << std::endl;
+      out << indent << "break;" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else if (field.type.basicType == Type::Message || field.type.basicType == Type::MessagePointer) {
+      out << indent << "case " << field.value << ":" << std::endl;
+      addIndent(indent);
+      out << indent << "assert(tag__.type == pbsl::Parser::WireType::LengthDelimited);" << std::endl;
+      out << indent << "visit__ = visitor__.template onBegin<" << msg.nativeName << ", " << field.value << ">();" << std::endl;
+      out << std::endl;
+      out << indent << "if (visit__ == pbsl::Visit::Continue) {" << std::endl;
+      addIndent(indent);
+      out << indent << "auto result__ = " << field.nativeAbsoluteType << "::visit(parser__.readMessage(), visitor__);" << std::endl;
+      out << std::endl;
+      out << indent << "if (result__ != pbsl::VisitResult::Done) {" << std::endl;
+      addIndent(indent);
+      out << indent << "return result__;" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+      out << std::endl;
+      out << indent << "visit__ = visitor__.template onEnd<" << msg.nativeName << ", " << field.value << ">();" << std::endl;
+      subIndent(indent);
+      out << indent << "} else {" << std::endl;
+      addIndent(indent);
+      out << indent << "parser__.skipField(tag__.type);" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+      out << indent << "break;" << std::endl;
+      subIndent(indent);
+   } else if (field.validateUtf8) {
+      out << indent << "case " << field.value << ":" << std::endl;
+      out << indent << "{" << std::endl;
+      addIndent(indent);
+      out << indent << "assert(tag__.type == pbsl::Parser::WireType::LengthDelimited);" << std::endl;
+      out << indent << "auto value__ = parser__.readString();" << std::endl;
+      dumpUtf8Check(out, msg, "value__", indent, "pbsl::VisitResult::Failed");
+      out << std::endl;
+      out << indent << "visit__ = " << hook << "(value__);" << std::endl;
+      out << indent << "break;" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else {
+      out << indent << "case " << field.value << ":" << std::endl;
+      addIndent(indent);
+      out << indent << "assert(tag__.type == pbsl::Parser::WireType::" << getWireTypeName(field.type) << ");" << std::endl;
+
+      if (field.type.basicType == Type::Enum) {
+         out << indent << "visit__ = " << hook << "(static_cast<" << field.nativeType << ">(parser__.readUint32()));" << std::endl;
+      } else {
+         assert(readItr != ReadTypeMap.end());
+         out << indent << "visit__ = " << hook << "(parser__." << readItr->second << "());" << std::endl;
+      }
+
+      out << indent << "break;" << std::endl;
+      subIndent(indent);
+   }
+}
+
+// Dumps visit(), which hands each field to the visitor instead of storing it.
+// Unknown fields are skipped so a visitor can read newer messages. Stopping
+// ends every enclosing visit() too, with Stopped rather than Failed so the
+// caller can tell an early exit from bad input.
+void dumpMessageVisitor(std::ostream &out, Message &msg, std::string indent)
+{
+   for (Message &submsg : msg.messages) {
+      dumpMessageVisitor(out, submsg, indent);
+   }
+
+   out << indent << "template<typename Visitor>" << std::endl;
+   out << indent << "pbsl::VisitResult " << msg.nativeName << "::visit(const std::string_view &data__, Visitor &visitor__)" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+   out << indent << "auto parser__ = pbsl::Parser { data__ };" << std::endl;
+   out << std::endl;
+   out << indent << "while (!parser__.eof()) {" << std::endl;
+   addIndent(indent);
+   {
+      out << indent << "auto tag__ = parser__.readTag();" << std::endl;
+      out << indent << "auto visit__ = pbsl::Visit::Continue;" << std::endl;
+      out << std::endl;
+      out << indent << "switch (tag__.field) {" << std::endl;
+
+      for (auto &field : msg.fields) {
+         dumpFieldVisitor(out, msg, field, indent);
+      }
+
+      out << indent << "default:" << std::endl;
+      addIndent(indent);
+      out << indent << "parser__.skipField(tag__.type);" << std::endl;
+      out << indent << "break;" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+      out << std::endl;
+      out << indent << "if (visit__ == pbsl::Visit::Stop) {" << std::endl;
+      addIndent(indent);
+      out << indent << "return pbsl::VisitResult::Stopped;" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   }
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+   out << std::endl;
+   out << indent << "return pbsl::VisitResult::Done;" << std::endl;
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+   out << std::endl;
+}
+
+// visit() is a template over the visitor, defined in a header of its own so
+// only code that visits pays for parser.h and visitor.h
+void dumpVisitorFile(ProtoFile &proto)
+{
+   if (proto.messages.size() == 0) {
+      return;
+   }
+
+   std::ofstream out("pbsl/" + proto.name + ".pbsl.visit.h");
+   out << "#pragma once" << std::endl;
+   out << "#include \"" + proto.name + ".pbsl.h\"" << std::endl;
+   out << "#include <pbsl/parser.h>" << std::endl;
+   out << "#include <pbsl/visitor.h>" << std::endl;
+
+   if (std::any_of(proto.messages.begin(), proto.messages.end(), hasUtf8Check)) {
+      out << "#include <pbsl/utf8.h>" << std::endl;
+   }
+
+   // Sub messages from imported files are visited by their own visit()
+   for (Import &import : proto.imports) {
+      if (import.file.find("google") != std::string::npos) {
+         continue;
+      }
+
+      auto file = std::tr2::sys::path(import.file).basename();
+      out << "#include \"" << file + ".pbsl.visit.h\"" << std::endl;
+   }
+
+   out << std::endl;
+
+   for (Message &msg : proto.messages) {
+      dumpMessageVisitor(out, msg, "");
+   }
+
+   out.close();
+}
+
+void dumpMessageParser(std::ostream &out, Message &msg, std::string indent)
+{
+   for (Message &submsg : msg.messages) {
+      dumpMessageParser(out, submsg, "");
+      out << std::endl;
+   }
+
+   // constexpr_parse messages are defined inline in the header
+   if (msg.constexprParse) {
+      return;
+   }
+
+   auto hotFields = std::vector<Field *> {};
+   auto coldFields = std::vector<Field *> {};
+   getProfiledFields(msg, hotFields, coldFields);
+
+   out << indent << "bool " << msg.nativeName << "::parse(const std::string_view &data__)" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+   dumpParseBody(out, msg, hotFields, coldFields, indent);
+   subIndent(indent);
+   out << indent << "};" << std::endl;
+   out << std::endl;
+   out << indent << "bool " << msg.nativeName << "::parseField(pbsl::Parser &parser__)" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+   dumpParseFieldBody(out, msg, hotFields, coldFields, indent);
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+
+   // Rarely seen fields are decoded out of line to keep the main loop small
+   if (coldFields.size()) {
+      out << std::endl;
+      out << indent << "PBSL_COLD PBSL_NOINLINE bool " << msg.nativeName << "::parseCold__(pbsl::Parser &parser__, unsigned field__, unsigned type__)" << std::endl;
+      out << indent << "{" << std::endl;
+      addIndent(indent);
+      out << indent << "auto tag__ = pbsl::Parser::Tag { field__, type__ };" << std::endl;
+      out << std::endl;
+      out << indent << "switch(tag__.field) {" << std::endl;
+
+      for (auto field : coldFields) {
+         dumpFieldParser(out, msg, *field, false, indent);
+      }
+
+      out << indent << "default:" << std::endl;
+      addIndent(indent);
+      out << indent << "if (!parser__.eof()) {" << std::endl;
+      addIndent(indent);
+      out << indent << "assert(0 && \"Invalid field number!\");" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+      out << indent << "return false;" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+      out << std::endl;
+      out << indent << "return true;" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   }
+}
+
+bool isTriviallyCopyable(Field &field)
+{
+   if (field.rule == FieldRule::Repeated || field.rule == FieldRule::Map || field.oneofIndex >= 0) {
+      return false;
+   }
+
+   switch (field.type.basicType) {
+   case Type::String:
+   case Type::Bytes:
+   case Type::Message:
+   case Type::MessagePointer:
+      return false;
+   default:
+      return true;
+   }
+}
+
+// Splits the members of msg, in declaration order, into runs of trivially
+// copyable members and single members which need a per type hash / compare.
+std::vector<std::vector<Field *>> getMemberRuns(Message &msg)
+{
+   auto runs = std::vector<std::vector<Field *>> {};
+   auto inRun = false;
+
+   for (auto &field : msg.fields) {
+      if (field.oneofIndex >= 0) {
+         continue;
+      }
+
+      auto trivial = isTriviallyCopyable(field);
+
+      if (!trivial || !inRun) {
+         runs.emplace_back();
+      }
+
+      runs.back().push_back(&field);
+      inRun = trivial;
+   }
+
+   return runs;
+}
+
+std::string getRunSize(std::vector<Field *> &run)
+{
+   auto size = std::string {};
+
+   for (auto field : run) {
+      if (size.size()) {
+         size += " + ";
+      }
+
+      size += "sizeof(" + field->nativeName + ")";
+   }
+
+   return size;
+}
+
+void dumpMessageHash(std::ostream &out, Message &msg, std::string indent)
+{
+   for (Message &submsg : msg.messages) {
+      dumpMessageHash(out, submsg, "");
+      out << std::endl;
+   }
+
+   out << indent << "uint64_t " << msg.nativeName << "::hash() const" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+   out << indent << "auto hash__ = uint64_t { 0 };" << std::endl;
+
+   for (auto &run : getMemberRuns(msg)) {
+      auto first = run.front()->nativeName;
+      auto last = run.back()->nativeName;
+
+      if (run.size() > 1) {
+         auto size = getRunSize(run);
+         out << std::endl;
+         out << indent << "if (pbsl::isContiguous(" << first << ", " << last << ", " << size << ")) {" << std::endl;
+         addIndent(indent);
+         out << indent << "hash__ = pbsl::hashBytes(&" << first << ", " << size << ", hash__);" << std::endl;
+         subIndent(indent);
+         out << indent << "} else {" << std::endl;
+         addIndent(indent);
+
+         for (auto field : run) {
+            out << indent << "hash__ = pbsl::hashCombine(hash__, pbsl::hashValue(" << field->nativeName << "));" << std::endl;
+         }
+
+         subIndent(indent);
+         out << indent << "}" << std::endl;
+         out << std::endl;
+      } else {
+         out << indent << "hash__ = pbsl::hashCombine(hash__, pbsl::hashValue(" << first << "));" << std::endl;
+      }
+   }
+
+   for (auto &oneof : msg.oneofs) {
+      out << indent << "hash__ = pbsl::hashCombine(hash__, pbsl::hashValue(" << oneof.nativeName << "));" << std::endl;
+   }
+
+   out << indent << "return hash__;" << std::endl;
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+   out << std::endl;
+
+   out << indent << "bool " << msg.nativeName << "::operator==(const " << msg.nativeName << " &other__) const" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+
+   for (auto &run : getMemberRuns(msg)) {
+      auto first = run.front()->nativeName;
+      auto last = run.back()->nativeName;
+
+      if (run.size() > 1) {
+         auto size = getRunSize(run);
+         out << indent << "if (pbsl::isContiguous(" << first << ", " << last << ", " << size << ")) {" << std::endl;
+         addIndent(indent);
+         out << indent << "if (std::memcmp(&" << first << ", &other__." << first << ", " << size << ") != 0) {" << std::endl;
+         addIndent(indent);
+         out << indent << "return false;" << std::endl;
+         subIndent(indent);
+         out << indent << "}" << std::endl;
+         subIndent(indent);
+         out << indent << "} else if (";
+
+         for (auto i = 0u; i < run.size(); ++i) {
+            if (i > 0) {
+               out << std::endl << indent << "        || ";
+            }
+
+            out << "!pbsl::equalValue(" << run[i]->nativeName << ", other__." << run[i]->nativeName << ")";
+         }
+
+         out << ") {" << std::endl;
+         addIndent(indent);
+         out << indent << "return false;" << std::endl;
+         subIndent(indent);
+         out << indent << "}" << std::endl;
+         out << std::endl;
+      } else {
+         out << indent << "if (!pbsl::equalValue(" << first << ", other__." << first << ")) {" << std::endl;
+         addIndent(indent);
+         out << indent << "return false;" << std::endl;
+         subIndent(indent);
+         out << indent << "}" << std::endl;
+         out << std::endl;
+      }
+   }
+
+   for (auto &oneof : msg.oneofs) {
+      out << indent << "if (!pbsl::equalValue(" << oneof.nativeName << ", other__." << oneof.nativeName << ")) {" << std::endl;
+      addIndent(indent);
+      out << indent << "return false;" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+      out << std::endl;
+   }
+
+   out << indent << "return true;" << std::endl;
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+}
+
+static const std::map<Type, std::string> WriteTypeMap = {
+   { Type::Double, "writeDouble" },
+   { Type::Float, "writeFloat" },
+   { Type::Int32, "writeInt32" },
+   { Type::Int64, "writeInt64" },
+   { Type::Uint32, "writeUint32" },
+   { Type::Uint64, "writeUint64" },
+   { Type::Sint32, "writeSint32" },
+   { Type::Sint64, "writeSint64" },
+   { Type::Fixed32, "writeFixed32" },
+   { Type::Fixed64, "writeFixed64" },
+   { Type::Sfixed32, "writeSfixed32" },
+   { Type::Sfixed64, "writeSfixed64" },
+   { Type::Bool, "writeBool" },
+   { Type::String, "writeString" },
+   { Type::Bytes, "writeBytes" }
+};
+
+// Writes a single value with its tag, messages are written in full as a
+// delta against their default value
+void dumpValueWriter(std::ostream &out, TypeInfo &type, const std::string &nativeAbsoluteType, const std::string &number, const std::string &value, const std::string &writer, std::string indent)
+{
+   auto writeItr = WriteTypeMap.find(type.basicType);
+
+   if (writeItr != WriteTypeMap.end()) {
+      out << indent << writer << ".writeTag(" << number << ", pbsl::Parser::WireType::" << getWireTypeName(type) << ");" << std::endl;
+      out << indent << writer << "." << writeItr->second << "(" << value << ");" << std::endl;
+   } else if (type.basicType == Type::Enum) {
+      out << indent << writer << ".writeTag(" << number << ", pbsl::Parser::WireType::VarInt);" << std::endl;
+      out << indent << writer << ".writeInt32(static_cast<int32_t>(" << value << "));" << std::endl;
+   } else if (type.basicType == Type::Message) {
+      out << indent << "pbsl::writeMessageDelta(" << writer << ", " << number << ", " << value << ");" << std::endl;
+   } else if (type.basicType == Type::MessagePointer) {
+      out << indent << "pbsl::writeMessageDelta(" << writer << ", " << number << ", " << value << " ? *" << value << " : pbsl::defaultValue<" << nativeAbsoluteType << ">());" << std::endl;
+   } else {
+      assert(false);
+   }
+}
+
+void dumpFieldDiff(std::ostream &out, Field &field, std::string indent)
+{
+   auto from = "from__." + field.nativeName;
+   auto to = "to__." + field.nativeName;
+
+   out << indent << "if (!pbsl::equalValue(" << from << ", " << to << ")) {" << std::endl;
+   addIndent(indent);
+
+   if (field.rule == FieldRule::Map) {
+      out << indent << "pbsl::writeTombstone(writer__, " << field.value << ");" << std::endl;
+      out << std::endl;
+      out << indent << "for (const auto &entry__ : " << to << ") {" << std::endl;
+      addIndent(indent);
+      out << indent << "auto encoded__ = std::string {};" << std::endl;
+      out << indent << "auto entryWriter__ = pbsl::Writer { encoded__ };" << std::endl;
+      dumpValueWriter(out, field.keyType, "", "1", "entry__.first", "entryWriter__", indent);
+      dumpValueWriter(out, field.type, field.nativeAbsoluteType, "2", "entry__.second", "entryWriter__", indent);
+      out << indent << "writer__.writeTag(" << field.value << ", pbsl::Parser::WireType::LengthDelimited);" << std::endl;
+      out << indent << "writer__.writeMessage(encoded__);" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else if (field.packedView) {
+      out << indent << "pbsl::writeTombstone(writer__, " << field.value << ");" << std::endl;
+      out << std::endl;
+      out << indent << "if (!" << to << ".empty()) {" << std::endl;
+      addIndent(indent);
+      out << indent << "writer__.writeTag(" << field.value << ", pbsl::Parser::WireType::LengthDelimited);" << std::endl;
+      out << indent << "writer__.writeBytes(" << to << ".bytes());" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else if (field.rule == FieldRule::Repeated) {
+      out << indent << "pbsl::writeTombstone(writer__, " << field.value << ");" << std::endl;
+      out << std::endl;
+      out << indent << "for (const auto &value__ : " << to << ") {" << std::endl;
+      addIndent(indent);
+      dumpValueWriter(out, field.type, field.nativeAbsoluteType, field.value, "value__", "writer__", indent);
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else if (field.type.basicType == Type::Message) {
+      out << indent << "pbsl::writeMessageDelta(writer__, " << field.value << ", " << from << ", " << to << ");" << std::endl;
+   } else if (field.type.basicType == Type::MessagePointer) {
+      out << indent << "if (!" << to << ") {" << std::endl;
+      addIndent(indent);
+      out << indent << "pbsl::writeTombstone(writer__, " << field.value << ");" << std::endl;
+      subIndent(indent);
+      out << indent << "} else {" << std::endl;
+      addIndent(indent);
+      out << indent << "pbsl::writeMessageDelta(writer__, " << field.value << ", " << from << " ? *" << from << " : pbsl::defaultValue<" << field.nativeAbsoluteType << ">(), *" << to << ");" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else {
+      dumpValueWriter(out, field.type, field.nativeAbsoluteType, field.value, to, "writer__", indent);
+   }
+
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+}
+
+void dumpOneofDiff(std::ostream &out, Message &msg, unsigned index, std::string indent)
+{
+   auto &oneof = msg.oneofs[index];
+   auto from = "from__." + oneof.nativeName;
+   auto to = "to__." + oneof.nativeName;
+   auto first = true;
+
+   out << indent << "if (!pbsl::equalValue(" << from << ", " << to << ")) {" << std::endl;
+   addIndent(indent);
+   out << indent << "switch (" << to << ".which()) {" << std::endl;
+
+   for (auto &field : msg.fields) {
+      if (field.oneofIndex != static_cast<int>(index)) {
+         continue;
+      }
+
+      // A tombstone on any alternative clears the oneof
+      if (first) {
+         out << indent << "case 0:" << std::endl;
+         addIndent(indent);
+         out << indent << "pbsl::writeTombstone(writer__, " << field.value << ");" << std::endl;
+         out << indent << "break;" << std::endl;
+         subIndent(indent);
+         first = false;
+      }
+
+      auto alternative = std::to_string(field.oneofCase);
+      auto value = to + ".get<" + alternative + ">()";
+      auto previous = from + ".get<" + alternative + ">()";
+      out << indent << "case " << alternative << ":" << std::endl;
+      addIndent(indent);
+
+      if (field.type.basicType == Type::Message) {
+         out << indent << "pbsl::writeMessageDelta(writer__, " << field.value << ", "
+             << from << ".which() == " << alternative << " ? " << previous << " : pbsl::defaultValue<" << field.nativeAbsoluteType << ">(), "
+             << value << ");" << std::endl;
+      } else if (field.type.basicType == Type::MessagePointer) {
+         out << indent << "pbsl::writeMessageDelta(writer__, " << field.value << ", "
+             << from << ".which() == " << alternative << " && " << previous << " ? *" << previous << " : pbsl::defaultValue<" << field.nativeAbsoluteType << ">(), "
+             << value << " ? *" << value << " : pbsl::defaultValue<" << field.nativeAbsoluteType << ">());" << std::endl;
+      } else {
+         dumpValueWriter(out, field.type, field.nativeAbsoluteType, field.value, value, "writer__", indent);
+      }
+
+      out << indent << "break;" << std::endl;
+      subIndent(indent);
+   }
+
+   out << indent << "}" << std::endl;
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+}
+
+size_t getTagSize(const std::string &number)
+{
+   auto tag = std::stoul(number) << 3;
+   auto size = size_t { 1 };
+
+   while (tag >= 0x80) {
+      tag >>= 7;
+      size++;
+   }
+
+   return size;
+}
+
+// Encoded size of a value with its tag, cached takes the size of messages
+// from their last byteSize() instead of computing it
+std::string getValueSize(TypeInfo &type, const std::string &number, const std::string &value, bool cached)
+{
+   auto byteSize = cached ? "cachedByteSize()" : "byteSize()";
+   auto tagSize = std::to_string(getTagSize(number));
+   auto writeItr = WriteTypeMap.find(type.basicType);
+
+   if (writeItr != WriteTypeMap.end()) {
+      return tagSize + " + pbsl::Writer::size" + writeItr->second.substr(5) + "(" + value + ")";
+   } else if (type.basicType == Type::Enum) {
+      return tagSize + " + pbsl::Writer::sizeInt32(static_cast<int32_t>(" + value + "))";
+   } else if (type.basicType == Type::Message) {
+      return tagSize + " + pbsl::Writer::sizeMessage(" + value + "." + byteSize + ")";
+   } else if (type.basicType == Type::MessagePointer) {
+      return tagSize + " + pbsl::Writer::sizeMessage(" + value + " ? " + value + "->" + byteSize + " : 0)";
+   }
+
+   assert(false);
+   return "0";
+}
+
+// Writes a value with its tag, unlike dumpValueWriter messages are written
+// in place after their cached size instead of being encoded on their own first
+void dumpValueSerializer(std::ostream &out, TypeInfo &type, const std::string &nativeAbsoluteType, const std::string &number, const std::string &value, std::string indent)
+{
+   if (type.basicType == Type::Message || type.basicType == Type::MessagePointer) {
+      auto message = value;
+
+      if (type.basicType == Type::MessagePointer) {
+         message = "(" + value + " ? *" + value + " : pbsl::defaultValue<" + nativeAbsoluteType + ">())";
+      }
+
+      out << indent << "writer__.writeTag(" << number << ", pbsl::Parser::WireType::LengthDelimited);" << std::endl;
+      out << indent << "writer__.writeVarUint64(" << message << ".cachedByteSize());" << std::endl;
+      out << indent << message << ".serializeCached(writer__);" << std::endl;
+   } else {
+      dumpValueWriter(out, type, nativeAbsoluteType, number, value, "writer__", indent);
+   }
+}
+
+// Scalars and strings are only written when they differ from their
+// default, as there is no presence to preserve
+std::string getValueIsSet(Field &field)
+{
+   auto &value = field.nativeName;
+
+   switch (field.type.basicType) {
+   case Type::String:
+   case Type::Bytes:
+      return "!" + value + ".empty()";
+   case Type::Bool:
+      return value;
+   default:
+      return value + " != 0";
+   }
+}
+
+std::string getMapEntrySize(Field &field, bool cached)
+{
+   return getValueSize(field.keyType, "1", "entry__.first", cached) + " + " + getValueSize(field.type, "2", "entry__.second", cached);
+}
+
+void dumpFieldSize(std::ostream &out, Field &field, std::string indent)
+{
+   auto tagSize = std::to_string(getTagSize(field.value));
+
+   if (field.rule == FieldRule::Map) {
+      out << indent << "for (const auto &entry__ : " << field.nativeName << ") {" << std::endl;
+      addIndent(indent);
+      out << indent << "size__ += " << tagSize << " + pbsl::Writer::sizeMessage(" << getMapEntrySize(field, false) << ");" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else if (field.packedView) {
+      out << indent << "if (!" << field.nativeName << ".empty()) {" << std::endl;
+      addIndent(indent);
+      out << indent << "size__ += " << tagSize << " + pbsl::Writer::sizeBytes(" << field.nativeName << ".bytes());" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else if (field.rule == FieldRule::Repeated) {
+      out << indent << "for (const auto &value__ : " << field.nativeName << ") {" << std::endl;
+      addIndent(indent);
+      out << indent << "size__ += " << getValueSize(field.type, field.value, "value__", false) << ";" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else if (field.type.basicType == Type::Message) {
+      out << indent << "if (auto messageSize__ = " << field.nativeName << ".byteSize()) {" << std::endl;
+      addIndent(indent);
+      out << indent << "size__ += " << tagSize << " + pbsl::Writer::sizeMessage(messageSize__);" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else if (field.type.basicType == Type::MessagePointer) {
+      out << indent << "if (" << field.nativeName << ") {" << std::endl;
+      addIndent(indent);
+      out << indent << "size__ += " << tagSize << " + pbsl::Writer::sizeMessage(" << field.nativeName << "->byteSize());" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else {
+      out << indent << "if (" << getValueIsSet(field) << ") {" << std::endl;
+      addIndent(indent);
+      out << indent << "size__ += " << getValueSize(field.type, field.value, field.nativeName, false) << ";" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   }
+}
+
+void dumpFieldSerializer(std::ostream &out, Field &field, std::string indent)
+{
+   if (field.rule == FieldRule::Map) {
+      out << indent << "for (const auto &entry__ : " << field.nativeName << ") {" << std::endl;
+      addIndent(indent);
+      out << indent << "writer__.writeTag(" << field.value << ", pbsl::Parser::WireType::LengthDelimited);" << std::endl;
+      out << indent << "writer__.writeVarUint64(" << getMapEntrySize(field, true) << ");" << std::endl;
+      dumpValueSerializer(out, field.keyType, "", "1", "entry__.first", indent);
+      dumpValueSerializer(out, field.type, field.nativeAbsoluteType, "2", "entry__.second", indent);
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else if (field.packedView) {
+      out << indent << "if (!" << field.nativeName << ".empty()) {" << std::endl;
+      addIndent(indent);
+      out << indent << "writer__.writeTag(" << field.value << ", pbsl::Parser::WireType::LengthDelimited);" << std::endl;
+      out << indent << "writer__.writeBytes(" << field.nativeName << ".bytes());" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else if (field.rule == FieldRule::Repeated) {
+      out << indent << "for (const auto &value__ : " << field.nativeName << ") {" << std::endl;
+      addIndent(indent);
+      dumpValueSerializer(out, field.type, field.nativeAbsoluteType, field.value, "value__", indent);
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else if (field.type.basicType == Type::Message) {
+      out << indent << "if (auto messageSize__ = " << field.nativeName << ".cachedByteSize()) {" << std::endl;
+      addIndent(indent);
+      out << indent << "writer__.writeTag(" << field.value << ", pbsl::Parser::WireType::LengthDelimited);" << std::endl;
+      out << indent << "writer__.writeVarUint64(messageSize__);" << std::endl;
+      out << indent << field.nativeName << ".serializeCached(writer__);" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else if (field.type.basicType == Type::MessagePointer) {
+      out << indent << "if (" << field.nativeName << ") {" << std::endl;
+      addIndent(indent);
+      out << indent << "writer__.writeTag(" << field.value << ", pbsl::Parser::WireType::LengthDelimited);" << std::endl;
+      out << indent << "writer__.writeVarUint64(" << field.nativeName << "->cachedByteSize());" << std::endl;
+      out << indent << field.nativeName << "->serializeCached(writer__);" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   } else {
+      out << indent << "if (" << getValueIsSet(field) << ") {" << std::endl;
+      addIndent(indent);
+      dumpValueSerializer(out, field.type, field.nativeAbsoluteType, field.value, field.nativeName, indent);
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   }
+}
+
+// The set alternative of a oneof is always written, even when it holds its
+// default value
+void dumpOneofSerializer(std::ostream &out, Message &msg, unsigned index, bool size, std::string indent)
+{
+   auto &oneof = msg.oneofs[index];
+
+   out << indent << "switch (" << oneof.nativeName << ".which()) {" << std::endl;
+
+   for (auto &field : msg.fields) {
+      if (field.oneofIndex != static_cast<int>(index)) {
+         continue;
+      }
+
+      auto alternative = std::to_string(field.oneofCase);
+      auto value = oneof.nativeName + ".get<" + alternative + ">()";
+      out << indent << "case " << alternative << ":" << std::endl;
+      addIndent(indent);
+
+      if (size) {
+         out << indent << "size__ += " << getValueSize(field.type, field.value, value, false) << ";" << std::endl;
+      } else {
+         dumpValueSerializer(out, field.type, field.nativeAbsoluteType, field.value, value, indent);
+      }
+
+      out << indent << "break;" << std::endl;
+      subIndent(indent);
+   }
+
+   out << indent << "}" << std::endl;
+}
+
+// byteSize() sizes the whole tree bottom up in one pass and caches the size
+// of every message in it, serializeCached() then writes the lengths of sub
+// messages from the cache instead of sizing them again at every level. The
+// cache is written through a const message, serializing one message from
+// several threads at once is a data race.
+void dumpMessageSerializer(std::ostream &out, Message &msg, std::string indent)
+{
+   for (Message &submsg : msg.messages) {
+      dumpMessageSerializer(out, submsg, "");
+      out << std::endl;
+   }
+
+   out << indent << "size_t " << msg.nativeName << "::byteSize() const" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+   out << indent << "auto size__ = size_t { 0 };" << std::endl;
+   out << std::endl;
+
+   for (auto &field : msg.fields) {
+      if (field.oneofIndex < 0) {
+         dumpFieldSize(out, field, indent);
+         out << std::endl;
+      }
+   }
+
+   for (auto i = 0u; i < msg.oneofs.size(); ++i) {
+      dumpOneofSerializer(out, msg, i, true, indent);
+      out << std::endl;
+   }
+
+   if (!msg.constexprParse) {
+      out << indent << "cachedSize__.value = size__;" << std::endl;
+   }
+
+   out << indent << "return size__;" << std::endl;
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+   out << std::endl;
+
+   out << indent << "void " << msg.nativeName << "::serialize(pbsl::Writer &writer__) const" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+   out << indent << "byteSize();" << std::endl;
+   out << indent << "serializeCached(writer__);" << std::endl;
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+   out << std::endl;
+
+   out << indent << "void " << msg.nativeName << "::serializeCached(pbsl::Writer &writer__) const" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+
+   auto first = true;
+
+   for (auto &field : msg.fields) {
+      if (field.oneofIndex < 0) {
+         if (!first) {
+            out << std::endl;
+         }
+
+         dumpFieldSerializer(out, field, indent);
+         first = false;
+      }
+   }
+
+   for (auto i = 0u; i < msg.oneofs.size(); ++i) {
+      if (!first) {
+         out << std::endl;
+      }
+
+      dumpOneofSerializer(out, msg, i, false, indent);
+      first = false;
+   }
+
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+}
+
+void dumpFieldClear(std::ostream &out, Message &msg, Field &field, std::string indent)
+{
+   out << indent << "case " << field.value << ":" << std::endl;
+   addIndent(indent);
+
+   if (field.oneofIndex >= 0) {
+      out << indent << msg.oneofs[field.oneofIndex].nativeName << ".reset();" << std::endl;
+   } else if (field.rule == FieldRule::Repeated || field.rule == FieldRule::Map) {
+      out << indent << field.nativeName << ".clear();" << std::endl;
+   } else if (field.type.basicType == Type::MessagePointer) {
+      out << indent << field.nativeName << ".reset();" << std::endl;
+   } else if (field.type.basicType == Type::Message) {
+      out << indent << field.nativeName << " = " << field.nativeAbsoluteType << " {};" << std::endl;
+   } else {
+      out << indent << field.nativeName << " = {};" << std::endl;
+   }
+
+   out << indent << "break;" << std::endl;
+   subIndent(indent);
+}
+
+void dumpMessageDelta(std::ostream &out, Message &msg, std::string indent)
+{
+   for (Message &submsg : msg.messages) {
+      dumpMessageDelta(out, submsg, "");
+      out << std::endl;
+   }
+
+   out << indent << "void " << msg.nativeName << "::diff(const " << msg.nativeName << " &from__, const " << msg.nativeName << " &to__, pbsl::Writer &writer__)" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+
+   auto first = true;
+
+   for (auto &field : msg.fields) {
+      if (field.oneofIndex < 0) {
+         if (!first) {
+            out << std::endl;
+         }
+
+         dumpFieldDiff(out, field, indent);
+         first = false;
+      }
+   }
+
+   for (auto i = 0u; i < msg.oneofs.size(); ++i) {
+      if (!first) {
+         out << std::endl;
+      }
+
+      dumpOneofDiff(out, msg, i, indent);
+      first = false;
+   }
+
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+   out << std::endl;
+
+   out << indent << "bool " << msg.nativeName << "::applyDelta(const std::string_view &data__)" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+
+   if (msg.fields.size() == 0) {
+      out << indent << "return true;" << std::endl;
+   } else {
+      out << indent << "auto parser__ = pbsl::Parser { data__ };" << std::endl;
+      out << std::endl;
+      out << indent << "while (!parser__.eof()) {" << std::endl;
+      addIndent(indent);
+      {
+         out << indent << "auto tag__ = parser__.readTag();" << std::endl;
+         out << std::endl;
+         out << indent << "if (tag__.type == pbsl::TombstoneWireType) {" << std::endl;
+         addIndent(indent);
+         {
+            out << indent << "switch (tag__.field) {" << std::endl;
+
+            for (auto &field : msg.fields) {
+               dumpFieldClear(out, msg, field, indent);
+            }
+
+            out << indent << "default:" << std::endl;
+            addIndent(indent);
+            out << indent << "return false;" << std::endl;
+            subIndent(indent);
+            out << indent << "}" << std::endl;
+            out << std::endl;
+            out << indent << "continue;" << std::endl;
+         }
+         subIndent(indent);
+         out << indent << "}" << std::endl;
+         out << std::endl;
+
+         out << indent << "switch (tag__.field) {" << std::endl;
+
+         for (auto &field : msg.fields) {
+            dumpFieldParser(out, msg, field, true, indent);
+         }
+
+         out << indent << "default:" << std::endl;
+         addIndent(indent);
+         {
+            out << indent << "if (!parser__.eof()) {" << std::endl;
+            addIndent(indent);
+            out << indent << "assert(0 && \"Invalid field number!\");" << std::endl;
+            subIndent(indent);
+            out << indent << "}" << std::endl;
+            out << indent << "return false;" << std::endl;
+         }
+         subIndent(indent);
+         out << indent << "}" << std::endl;
+      }
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+      out << std::endl;
+      out << indent << "return true;" << std::endl;
+   }
+
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+}
+
+bool hasStringData(Type type)
+{
+   return type == Type::String || type == Type::Bytes || type == Type::Message || type == Type::MessagePointer;
+}
+
+void dumpValueStringSize(std::ostream &out, Type type, const std::string &value, std::string indent)
+{
+   if (type == Type::String || type == Type::Bytes) {
+      out << indent << "size__ += " << value << ".size();" << std::endl;
+   } else if (type == Type::Message) {
+      out << indent << "size__ += " << value << ".stringPoolSize();" << std::endl;
+   } else if (type == Type::MessagePointer) {
+      out << indent << "size__ += " << value << " ? " << value << "->stringPoolSize() : 0;" << std::endl;
+   }
+}
+
+void dumpValueStringRelocate(std::ostream &out, Type type, const std::string &value, std::string indent)
+{
+   if (type == Type::String || type == Type::Bytes) {
+      out << indent << value << " = pool__.store(" << value << ");" << std::endl;
+   } else if (type == Type::Message) {
+      out << indent << value << ".relocateStrings(pool__);" << std::endl;
+   } else if (type == Type::MessagePointer) {
+      out << indent << "if (" << value << ") {" << std::endl;
+      addIndent(indent);
+      out << indent << value << "->relocateStrings(pool__);" << std::endl;
+      subIndent(indent);
+      out << indent << "}" << std::endl;
+   }
+}
+
+// Dumps the walk over every string held by msg, as the body of either
+// stringPoolSize() or relocateStrings()
+void dumpStringWalk(std::ostream &out, Message &msg, bool relocate, std::string indent)
+{
+   auto dumpValue = relocate ? dumpValueStringRelocate : dumpValueStringSize;
+   auto first = true;
+   auto previousBlock = false;
+
+   for (auto &field : msg.fields) {
+      auto keyHasStrings = field.rule == FieldRule::Map && hasStringData(field.keyType.basicType);
+
+      // Interned strings are owned by their table, not the input
+      if ((!hasStringData(field.type.basicType) && !keyHasStrings && !field.packedView) || field.intern) {
+         continue;
+      }
+
+      // Blocks are separated from their neighbours by an empty line
+      auto block = field.oneofIndex >= 0 || field.rule == FieldRule::Map || field.rule == FieldRule::Repeated
+         || (relocate && field.type.basicType == Type::MessagePointer);
+
+      if (!first && (block || previousBlock)) {
+         out << std::endl;
+      }
+
+      first = false;
+      previousBlock = block;
+
+      if (field.oneofIndex >= 0) {
+         auto &oneof = msg.oneofs[field.oneofIndex];
+         auto alternative = std::to_string(field.oneofCase);
+         out << indent << "if (" << oneof.nativeName << ".which() == " << alternative << ") {" << std::endl;
+         addIndent(indent);
+         dumpValue(out, field.type.basicType, oneof.nativeName + ".get<" + alternative + ">()", indent);
+         subIndent(indent);
+         out << indent << "}" << std::endl;
+      } else if (field.packedView) {
+         if (relocate) {
+            out << indent << field.nativeName << ".assign(pool__.store(" << field.nativeName << ".bytes()));" << std::endl;
+         } else {
+            out << indent << "size__ += " << field.nativeName << ".bytes().size();" << std::endl;
+         }
+      } else if (field.rule == FieldRule::Map) {
+         // Relocated keys compare equal to the old ones so they keep their slot
+         out << indent << "for (auto &entry__ : " << field.nativeName << ") {" << std::endl;
+         addIndent(indent);
+         dumpValue(out, field.keyType.basicType, "entry__.first", indent);
+         dumpValue(out, field.type.basicType, "entry__.second", indent);
+         subIndent(indent);
+         out << indent << "}" << std::endl;
+      } else if (field.rule == FieldRule::Repeated) {
+         out << indent << "for (auto &value__ : " << field.nativeName << ") {" << std::endl;
+         addIndent(indent);
+         dumpValue(out, field.type.basicType, "value__", indent);
+         subIndent(indent);
+         out << indent << "}" << std::endl;
+      } else {
+         dumpValue(out, field.type.basicType, field.nativeName, indent);
+      }
+   }
+}
+
+void dumpMessageOwned(std::ostream &out, Message &msg, std::string indent)
+{
+   for (Message &submsg : msg.messages) {
+      dumpMessageOwned(out, submsg, "");
+      out << std::endl;
+   }
+
+   out << indent << "bool " << msg.nativeName << "::parseOwned(const std::string_view &data__, pbsl::StringPool &pool__)" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+
+   // Strings left from an earlier parseOwned() point into the pool, which
+   // reset() is about to release or overwrite
+   out << indent << "*this = " << msg.nativeName << " {};" << std::endl;
+   out << std::endl;
+   out << indent << "if (!parse(data__)) {" << std::endl;
+   addIndent(indent);
+   out << indent << "return false;" << std::endl;
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+   out << std::endl;
+   out << indent << "pool__.reset(stringPoolSize());" << std::endl;
+   out << indent << "relocateStrings(pool__);" << std::endl;
+   out << indent << "return true;" << std::endl;
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+   out << std::endl;
+
+   auto hasStrings = std::any_of(msg.fields.begin(), msg.fields.end(), [](Field &field) {
+         return (hasStringData(field.type.basicType) && !field.intern) || (field.rule == FieldRule::Map && hasStringData(field.keyType.basicType)) || field.packedView;
+      });
+
+   out << indent << "size_t " << msg.nativeName << "::stringPoolSize() const" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+
+   if (hasStrings) {
+      out << indent << "auto size__ = size_t { 0 };" << std::endl;
+      out << std::endl;
+      dumpStringWalk(out, msg, false, indent);
+      out << std::endl;
+      out << indent << "return size__;" << std::endl;
+   } else {
+      out << indent << "return 0;" << std::endl;
+   }
+
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+   out << std::endl;
+
+   out << indent << "void " << msg.nativeName << "::relocateStrings(pbsl::StringPool &" << (hasStrings ? "pool__" : "") << ")" << std::endl;
+   out << indent << "{" << std::endl;
+   addIndent(indent);
+   dumpStringWalk(out, msg, true, indent);
+   subIndent(indent);
+   out << indent << "}" << std::endl;
+}
+
+void dumpSourceFile(ProtoFile &proto)
+{
+   if (proto.messages.size() == 0) {
+      return;
+   }
+
+   std::ofstream out("pbsl/" + proto.name + ".pbsl.cpp");
+   out << "#include \"" + proto.name + ".pbsl.h\"" << std::endl;
+   out << "#include <pbsl/parser.h>" << std::endl;
+   out << "#include <pbsl/hash.h>" << std::endl;
+   out << "#include <pbsl/delta.h>" << std::endl;
+   out << "#include <pbsl/stringpool.h>" << std::endl;
+   out << "#include <pbsl/utf8.h>" << std::endl;
+   out << "#include <cstring>" << std::endl;
+   out << std::endl;
+
+   // Dump messages
+   for (Message &msg : proto.messages) {
+      dumpMessageParser(out, msg, "");
+      out << std::endl;
+   }
+
+   // Dump hash() and operator==
+   for (Message &msg : proto.messages) {
+      dumpMessageHash(out, msg, "");
+      out << std::endl;
+   }
+
+   // Dump diff() and applyDelta()
+   for (Message &msg : proto.messages) {
+      dumpMessageDelta(out, msg, "");
+      out << std::endl;
+   }
+
+   // Dump byteSize() and serialize()
+   for (Message &msg : proto.messages) {
+      dumpMessageSerializer(out, msg, "");
+      out << std::endl;
+   }
+
+   // Dump parseOwned()
+   for (Message &msg : proto.messages) {
+      dumpMessageOwned(out, msg, "");
+      out << std::endl;
    }
 
-   for (auto &msg : msg.messages) {
-      createNativeNames(msg, path);
+   out.close();
+}
+
+void registerMessages(Message &msg)
+{
+   MessageMap[msg.nativeName] = &msg;
+
+   for (auto &submsg : msg.messages) {
+      registerMessages(submsg);
    }
 }
 
-void resolveLookupTypes(Message &msg)
+// Messages decoded in constant expressions must be literal types, vectors,
+// maps, oneofs and heap allocated messages are not.
+bool canParseConstexpr(Message &msg)
 {
    for (auto &field : msg.fields) {
-      if (field.type.basicType == Type::LookupName) {
-         if (field.nativeAbsoluteType.compare(msg.nativeName) == 0) {
-            field.type.basicType = Type::MessagePointer;
-         } else {
-            auto itr = DeclarationTypeMap.find(field.nativeAbsoluteType);
+      if (field.rule == FieldRule::Repeated || field.rule == FieldRule::Map || field.oneofIndex >= 0) {
+         return false;
+      }
 
-            if (itr == DeclarationTypeMap.end()) {
-               // TODO: It must be from the import - awh fuk?!
-               field.type.basicType = Type::Message;
-            } else {
-               field.type.basicType = itr->second;
-            }
+      if (field.type.basicType == Type::MessagePointer || field.intern) {
+         return false;
+      }
+
+      if (field.type.basicType == Type::Message) {
+         auto itr = MessageMap.find(field.nativeAbsoluteType);
+
+         if (itr == MessageMap.end()
+          || !isOptionSet(itr->second->options, "constexpr_parse")
+          || !canParseConstexpr(*itr->second)) {
+            return false;
          }
       }
    }
 
-   for (auto &msg : msg.messages) {
-      resolveLookupTypes(msg);
+   return true;
+}
+
+void resolveConstexprParse(Message &msg)
+{
+   if (isOptionSet(msg.options, "constexpr_parse")) {
+      msg.constexprParse = canParseConstexpr(msg);
+
+      if (!msg.constexprParse) {
+         std::cout << "Ignoring constexpr_parse for " << msg.nativeName
+                   << ", only singular scalar, non interned string and constexpr_parse message fields are supported" << std::endl;
+      }
+   }
+
+   for (auto &submsg : msg.messages) {
+      resolveConstexprParse(submsg);
    }
 }
 
-void reorderMessageDependences(std::vector<Message> &messages)
+// Decides which string fields have their UTF-8 validated while parsing, set
+// per file with "option validate_utf8 = true;" and overridden per message and
+// per field with the same option. Nested messages inherit the option of the
+// message they are declared in.
+void resolveValidateUtf8(Message &msg, bool inherited)
 {
-   for (auto itr = messages.begin(); itr != messages.end(); ++itr) {
-      auto &msg = *itr;
+   auto validate = isOptionSet(msg.options, "validate_utf8", inherited);
 
-      for (auto &field : msg.fields) {
-         auto find = field.nativeAbsoluteType;
-         auto found = std::find_if(messages.begin(), messages.end(), [&find](Message &search){
-               return search.name.compare(find) == 0;
-            });
-
-         if (found != messages.end()) {
-            if (found > itr) {
-               std::iter_swap(found, itr);
-               break;
-            }
+   for (auto &field : msg.fields) {
+      if (field.type.basicType == Type::String || (field.rule == FieldRule::Map && field.keyType.basicType == Type::String)) {
+         field.validateUtf8 = isOptionSet(field.options, "validate_utf8", validate);
+         msg.parseCanFail = msg.parseCanFail || field.validateUtf8;
+      }
+   }
+
+   for (auto &submsg : msg.messages) {
+      resolveValidateUtf8(submsg, validate);
+   }
+}
+
+// A message fails to parse when one of its sub messages does, or may fail
+// when that is from an imported file. Walks from every message that can fail
+// back to the messages with fields of its type, so each message and field is
+// visited once, pointer cycles included.
+void propagateParseCanFail()
+{
+   auto parents = std::map<Message *, std::vector<Message *>> {};
+   auto pending = std::vector<Message *> {};
+
+   for (auto &entry : MessageMap) {
+      auto msg = entry.second;
+
+      for (auto &field : msg->fields) {
+         auto isMessage = field.type.basicType == Type::Message || field.type.basicType == Type::MessagePointer;
+
+         if (isMessage) {
+            msg->parseCanFail = msg->parseCanFail || canFailParse(field);
+         }
+
+         auto itr = MessageMap.find(field.nativeAbsoluteType);
+
+         if (isMessage && itr != MessageMap.end()) {
+            parents[itr->second].push_back(msg);
+         }
+      }
+
+      if (msg->parseCanFail) {
+         pending.push_back(msg);
+      }
+   }
+
+   while (!pending.empty()) {
+      auto msg = pending.back();
+      pending.pop_back();
+
+      for (auto parent : parents[msg]) {
+         if (!parent->parseCanFail) {
+            parent->parseCanFail = true;
+            pending.push_back(parent);
+         }
+      }
+   }
+}
+
+bool isFixedWidth(Type type)
+{
+   switch (type) {
+   case Type::Float:
+   case Type::Double:
+   case Type::Fixed32:
+   case Type::Fixed64:
+   case Type::Sfixed32:
+   case Type::Sfixed64:
+      return true;
+   default:
+      return false;
+   }
+}
+
+// Repeated fixed width fields with "packed_view = true" are decoded as a view
+// of their packed payload, parse() fails on a message whose view is already set
+void resolvePackedView(Message &msg)
+{
+   for (auto &field : msg.fields) {
+      if (!isOptionSet(field.options, "packed_view")) {
+         continue;
+      }
+
+      // parse() fails on elements the view cannot hold
+      if (field.rule == FieldRule::Repeated && isFixedWidth(field.type.basicType)) {
+         field.packedView = true;
+         msg.parseCanFail = true;
+      } else {
+         std::cout << "Ignoring packed_view for " << msg.nativeName << "." << field.name
+                   << ", only repeated float, double, fixed and sfixed fields are supported" << std::endl;
+      }
+   }
+
+   for (auto &submsg : msg.messages) {
+      resolvePackedView(submsg);
+   }
+}
+
+// Singular and repeated string or bytes fields with "intern = true" hold
+// canonical strings from the thread's pbsl::InternScope table, or from
+// pbsl::defaultInternTable() outside of any scope
+void resolveIntern(Message &msg)
+{
+   for (auto &field : msg.fields) {
+      if (!isOptionSet(field.options, "intern")) {
+         continue;
+      }
+
+      auto isString = field.type.basicType == Type::String || field.type.basicType == Type::Bytes;
+
+      if (isString && field.rule != FieldRule::Map && field.oneofIndex < 0) {
+         field.intern = true;
+         field.nativeType = "pbsl::InternedString";
+      } else {
+         std::cout << "Ignoring intern for " << msg.nativeName << "." << field.name
+                   << ", only singular and repeated string and bytes fields are supported" << std::endl;
+      }
+   }
+
+   for (auto &submsg : msg.messages) {
+      resolveIntern(submsg);
+   }
+}
+
+void describeField(std::ostream &out, const Field &field, const std::string &indent)
+{
+   out << indent << "field " << field.name << " = " << field.value
+       << " rule " << static_cast<int>(field.rule)
+       << " type " << static_cast<int>(field.type.basicType) << " " << field.type.className
+       << " key " << static_cast<int>(field.keyType.basicType) << " " << field.keyType.className
+       << " oneof " << field.oneofIndex << " " << field.oneofCase
+       << " flags " << field.validateUtf8 << field.packedView << field.intern
+       << " native " << field.nativeName << " " << field.nativeType << " " << field.nativeAbsoluteType << " " << field.nativeKeyType << std::endl;
+
+   for (auto &option : field.options) {
+      out << indent << "   option " << option.name << " = " << option.value << std::endl;
+   }
+}
+
+void describeEnum(std::ostream &out, const Enum &enum_, const std::string &indent)
+{
+   out << indent << "enum " << enum_.name << " native " << enum_.nativeName << std::endl;
+
+   for (auto &field : enum_.fields) {
+      describeField(out, field, indent + "   ");
+   }
+}
+
+void describeMessage(std::ostream &out, const Message &msg, const std::string &indent)
+{
+   out << indent << "message " << msg.name << " native " << msg.nativeName << " flags " << msg.constexprParse << msg.forwardDeclare << msg.parseCanFail << std::endl;
+
+   for (auto &option : msg.options) {
+      out << indent << "   option " << option.name << " = " << option.value << std::endl;
+   }
+
+   for (auto &oneof : msg.oneofs) {
+      out << indent << "   oneof " << oneof.name << " native " << oneof.nativeName << " " << oneof.nativeCaseName << std::endl;
+   }
+
+   for (auto &field : msg.fields) {
+      describeField(out, field, indent + "   ");
+   }
+
+   for (auto &enum_ : msg.enums) {
+      describeEnum(out, enum_, indent + "   ");
+   }
+
+   for (auto &submsg : msg.messages) {
+      describeMessage(out, submsg, indent + "   ");
+   }
+}
+
+// Everything a frontend and the resolver produced for a file, one line per
+// item, in order
+std::string describeFile(const ProtoFile &proto)
+{
+   auto out = std::ostringstream {};
+
+   for (auto &import : proto.imports) {
+      out << "import " << import.file << std::endl;
+   }
+
+   for (auto &option : proto.options) {
+      out << "option " << option.name << " = " << option.value << std::endl;
+   }
+
+   for (auto &enum_ : proto.enums) {
+      describeEnum(out, enum_, "");
+   }
+
+   for (auto &msg : proto.messages) {
+      describeMessage(out, msg, "");
+   }
+
+   return out.str();
+}
+
+// Times both frontends on a file and checks that they produce the same
+// resolved file
+bool benchmarkFrontends(const std::string &path, int iterations)
+{
+   using Clock = std::chrono::steady_clock;
+
+   auto time = [&](bool (*parse)(std::string, ProtoFile &), ProtoFile &result) {
+      auto start = Clock::now();
+
+      for (auto i = 0; i < iterations; ++i) {
+         result = ProtoFile {};
+
+         if (!parse(path, result)) {
+            return -1.0;
          }
       }
+
+      return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+   };
+
+   auto prsProto = ProtoFile {};
+   auto fastProto = ProtoFile {};
+   auto prsTime = time(&parseFile, prsProto);
+   auto fastTime = time(&parseFileFast, fastProto);
+
+   if (prsTime < 0 || fastTime < 0) {
+      return false;
+   }
+
+   std::cout << path << ": prs " << prsTime << " ms, fast " << fastTime << " ms, "
+             << prsTime / std::max(fastTime, 1e-9) << "x" << std::endl;
+
+   auto prsResolved = resolveFile(prsProto);
+   auto fastResolved = resolveFile(fastProto);
+
+   if (prsResolved != fastResolved) {
+      std::cout << "Frontends disagree, only " << (prsResolved ? "prs" : "fast") << " resolved" << std::endl;
+      return false;
+   }
+
+   auto prsLines = std::istringstream { describeFile(prsProto) };
+   auto fastLines = std::istringstream { describeFile(fastProto) };
+   auto prsLine = std::string {};
+   auto fastLine = std::string {};
+
+   for (auto line = 1; ; ++line) {
+      auto prsMore = static_cast<bool>(std::getline(prsLines, prsLine));
+      auto fastMore = static_cast<bool>(std::getline(fastLines, fastLine));
+
+      if (!prsMore && !fastMore) {
+         break;
+      }
+
+      if (prsMore != fastMore || prsLine != fastLine) {
+         std::cout << "Frontends disagree at item " << line << " of the resolved file" << std::endl;
+         std::cout << "   prs:  " << (prsMore ? prsLine : "<end>") << std::endl;
+         std::cout << "   fast: " << (fastMore ? fastLine : "<end>") << std::endl;
+         return false;
+      }
    }
+
+   return true;
 }
 
 int main(int argc, char **argv)
 {
    std::map<std::string, ProtoFile> protos;
+   std::vector<std::string> files;
 
    for (auto i = 1; i < argc; ++i) {
-      std::tr2::sys::path path(argv[i]);
+      if (strcmp(argv[i], "--precount") == 0) {
+         PrecountRepeated = true;
+         continue;
+      }
+
+      if (strcmp(argv[i], "--prs") == 0) {
+         UsePrsFrontend = true;
+         continue;
+      }
+
+      if (strcmp(argv[i], "--bench-frontends") == 0) {
+         // --bench-frontends <iterations> <file>...
+         auto iterations = (i + 1 < argc) ? atoi(argv[++i]) : 0;
+
+         if (iterations <= 0) {
+            std::cout << "Expected iteration count after --bench-frontends" << std::endl;
+            return -1;
+         }
+
+         for (++i; i < argc; ++i) {
+            if (!benchmarkFrontends(argv[i], iterations)) {
+               return -1;
+            }
+         }
+
+         return 0;
+      }
+
+      if (strcmp(argv[i], "--profile") == 0) {
+         if (i + 1 == argc || !readFieldProfile(argv[++i])) {
+            std::cout << "Could not read field profile" << std::endl;
+            return -1;
+         }
+
+         continue;
+      }
+
+      files.push_back(argv[i]);
+   }
+
+   // Options apply to every file, wherever they appear on the command line
+   for (auto &file : files) {
+      std::tr2::sys::path path(file);
       auto filename = path.leaf();
       auto proto = protos[filename];
       proto.name = path.basename();
 
-      if (!parseFile(path, proto)) {
+      auto parsed = UsePrsFrontend ? parseFile(path, proto) : parseFileFast(path, proto);
+
+      if (!parsed) {
          std::cout << "Parse failed for file " << path << std::endl;
          return -1;
       }
 
-      // Resolve all the .nativeName and .nativeType properties
-      for (auto &enum_ : proto.enums) {
-         createNativeNames(enum_);
+      // Resolve native names and types and order messages by their dependencies
+      if (!resolveFile(proto)) {
+         std::cout << "Resolve failed for file " << path << std::endl;
+         return -1;
+      }
+
+      // Decide which messages can be decoded in constant expressions
+      MessageMap.clear();
+
+      for (auto &msg : proto.messages) {
+         registerMessages(msg);
       }
 
       for (auto &msg : proto.messages) {
-         createNativeNames(msg);
+         resolvePackedView(msg);
+         resolveIntern(msg);
+         resolveConstexprParse(msg);
       }
 
-      // Resolve all Type::LookupNames so we know whether to parse an enum or msg
+      // Decide which strings are validated, failures of these and of packed
+      // views propagate to parents
+      auto validateUtf8 = isOptionSet(proto.options, "validate_utf8");
+
       for (auto &msg : proto.messages) {
-         resolveLookupTypes(msg);
+         resolveValidateUtf8(msg, validateUtf8);
       }
 
-      // Reorder dependencies
-      reorderMessageDependences(proto.messages);
-      
+      propagateParseCanFail();
+
       // Dump our header file!
       dumpHeaderFile(proto);
 
       // Dump our source file!
       dumpSourceFile(proto);
+
+      // Dump visit() for the messages
+      dumpVisitorFile(proto);
    }
 
    return 0;
@@ -0,0 +1,149 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Empty files can not be mapped, they are all the same anyway
+static const char EmptyFile[] = "";
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() :
+   mData(nullptr),
+   mSize(0),
+   mFile(INVALID_HANDLE_VALUE),
+   mMapping(nullptr)
+{
+}
+
+bool MappedFile::open(const std::string &path)
+{
+   close();
+   mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+   if (mFile == INVALID_HANDLE_VALUE) {
+      return false;
+   }
+
+   LARGE_INTEGER size;
+
+   if (!GetFileSizeEx(mFile, &size)) {
+      close();
+      return false;
+   }
+
+   if (size.QuadPart == 0) {
+      mData = EmptyFile;
+      return true;
+   }
+
+   mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+   if (!mMapping) {
+      close();
+      return false;
+   }
+
+   mData = static_cast<const char *>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+
+   if (!mData) {
+      close();
+      return false;
+   }
+
+   mSize = static_cast<size_t>(size.QuadPart);
+   return true;
+}
+
+void MappedFile::close()
+{
+   if (mData && mData != EmptyFile) {
+      UnmapViewOfFile(mData);
+   }
+
+   if (mMapping) {
+      CloseHandle(mMapping);
+   }
+
+   if (mFile != INVALID_HANDLE_VALUE) {
+      CloseHandle(mFile);
+   }
+
+   mData = nullptr;
+   mSize = 0;
+   mFile = INVALID_HANDLE_VALUE;
+   mMapping = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile() :
+   mData(nullptr),
+   mSize(0),
+   mFile(-1)
+{
+}
+
+bool MappedFile::open(const std::string &path)
+{
+   close();
+   mFile = ::open(path.c_str(), O_RDONLY);
+
+   if (mFile < 0) {
+      return false;
+   }
+
+   struct stat info;
+
+   if (fstat(mFile, &info) != 0) {
+      close();
+      return false;
+   }
+
+   if (info.st_size == 0) {
+      mData = EmptyFile;
+      return true;
+   }
+
+   auto data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, mFile, 0);
+
+   if (data == MAP_FAILED) {
+      close();
+      return false;
+   }
+
+   madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+   mData = static_cast<const char *>(data);
+   mSize = static_cast<size_t>(info.st_size);
+   return true;
+}
+
+void MappedFile::close()
+{
+   if (mData && mData != EmptyFile) {
+      munmap(const_cast<char *>(mData), mSize);
+   }
+
+   if (mFile >= 0) {
+      ::close(mFile);
+   }
+
+   mData = nullptr;
+   mSize = 0;
+   mFile = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+   close();
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read only view of a whole file mapped into memory
+class MappedFile
+{
+public:
+   MappedFile();
+   ~MappedFile();
+
+   MappedFile(const MappedFile &) = delete;
+   MappedFile &operator=(const MappedFile &) = delete;
+
+   bool open(const std::string &path);
+   void close();
+
+   const char *data() const
+   {
+      return mData;
+   }
+
+   size_t size() const
+   {
+      return mSize;
+   }
+
+private:
+   const char *mData;
+   size_t mSize;
+
+#ifdef _WIN32
+   void *mFile;
+   void *mMapping;
+#else
+   int mFile;
+#endif
+};
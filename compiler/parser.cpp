@@ -59,6 +59,21 @@ auto property_def =
    -field_options_rule >> // [option = value]
    char_(';');
 
+// map property
+parse_rule<ast_map_field> map_property_rule;
+auto map_property_def =
+   string_("map") >>
+   char_('<') >>
+   symbol_rule >> // key type
+   char_(',') >>
+   symbol_rule >> // value type
+   char_('>') >>
+   symbol_rule >> // name
+   char_('=') >>
+   number_rule >> // value
+   -field_options_rule >> // [option = value]
+   char_(';');
+
 // option
 parse_rule<Option> option_rule;
 auto option_def =
@@ -91,6 +106,15 @@ auto import_def =
    string_rule >> // "path"
    char_(';');
 
+// oneof
+parse_rule<Oneof> oneof_rule;
+auto oneof_def =
+   string_("oneof") >>
+   symbol_rule >> // name
+   char_('{') >>
+   *(property_rule) >> // alternatives
+   char_('}');
+
 // message
 parse_rule<Message> message_rule;
 auto message_def =
@@ -100,6 +124,8 @@ auto message_def =
    *(option_rule   // option
    | message_rule  // child message
    | enum_rule     // child enum
+   | oneof_rule    // oneof
+   | map_property_rule // map property
    | property_rule) >> // property
    char_('}');
 
@@ -128,11 +154,13 @@ bool initParser()
    if (!isParserStarted) {
       message_rule = message_def;
       property_rule = property_def;
+      map_property_rule = map_property_def;
       enum_rule = enum_def;
       field_options_rule = field_options_def;
       import_rule = import_def;
       option_rule = option_def;
       extend_rule = extend_def;
+      oneof_rule = oneof_def;
       number_rule = number_def;
       string_rule = string_def;
       proto_parser = proto_def;
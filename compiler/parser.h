@@ -6,6 +6,9 @@
 
 bool parseFile(std::string path, struct ProtoFile &result);
 
+// Hand written frontend, same result as parseFile without the prs grammar
+bool parseFileFast(std::string path, struct ProtoFile &result);
+
 enum class Type
 {
    Invalid,
@@ -70,7 +73,8 @@ enum class FieldRule
    None,
    Optional,
    Required,
-   Repeated
+   Repeated,
+   Map
 };
 
 struct FieldOption
@@ -89,13 +93,20 @@ struct FieldOption
 struct Field
 {
    FieldRule rule = FieldRule::None;
+   int oneofIndex = -1;
+   unsigned oneofCase = 0;
+   bool validateUtf8 = false;
+   bool packedView = false;
+   bool intern = false;
    TypeInfo type;
+   TypeInfo keyType;
    std::string name;
    std::string value;
    std::vector<FieldOption> options;
    std::string nativeName;
    std::string nativeType;
    std::string nativeAbsoluteType;
+   std::string nativeKeyType;
 
    template<typename Result>
    void construct(Result &&result)
@@ -184,12 +195,35 @@ struct Option
    }
 };
 
+struct Oneof
+{
+   std::string name;
+   std::string nativeName;
+   std::string nativeCaseName;
+   std::vector<Field> fields;
+
+   template<typename Result>
+   void construct(Result &&result)
+   {
+      name = std::move(std::get<1>(result).value);
+      fields = std::move(std::get<3>(result));
+   }
+};
+
 struct Message
 {
    std::string name;
    std::string nativeName;
+   bool constexprParse = false;
+   bool forwardDeclare = false;
+
+   // parse() can fail on input it cannot keep, invalid UTF-8 or a packed
+   // view it cannot hold, in this message or in one of its sub messages
+   bool parseCanFail = false;
+
    std::vector<Option> options;
    std::vector<Field> fields;
+   std::vector<Oneof> oneofs;
    std::vector<Message> messages;
    std::vector<Enum> enums;
 
@@ -211,7 +245,27 @@ struct Message
             enums.push_back(std::move(*std::get<2>(content)));
             break;
          case 3:
-            fields.push_back(std::move(*std::get<3>(content)));
+         {
+            // Alternatives live in fields, tagged with the index of their oneof
+            auto &oneof = *std::get<3>(content);
+            auto index = static_cast<int>(oneofs.size());
+            auto alternative = 0u;
+
+            for (auto &field : oneof.fields) {
+               field.oneofIndex = index;
+               field.oneofCase = ++alternative;
+               fields.push_back(std::move(field));
+            }
+
+            oneof.fields.clear();
+            oneofs.push_back(std::move(oneof));
+            break;
+         }
+         case 4:
+            fields.push_back(std::move(std::get<4>(content)->field));
+            break;
+         case 5:
+            fields.push_back(std::move(*std::get<5>(content)));
             break;
          }
       }
@@ -284,6 +338,30 @@ struct ast_field_options
    }
 };
 
+// map<key, value> name = number [option = value];
+struct ast_map_field
+{
+   Field field;
+
+   template<typename Result>
+   void construct(Result &&result)
+   {
+      field.rule = FieldRule::Map;
+      field.keyType = TypeInfo::getTypeByName(std::get<2>(result).value);
+      field.type = TypeInfo::getTypeByName(std::get<4>(result).value);
+      field.name = std::move(std::get<6>(result).value);
+      field.value = std::move(std::get<8>(result).value);
+
+      if (std::get<9>(result)) {
+         auto &opts = *std::get<9>(result);
+
+         for (auto &opt : opts.options) {
+            field.options.push_back({ std::move(opt.name), std::move(opt.value) });
+         }
+      }
+   }
+};
+
 struct ast_enum_value
 {
    std::string name;
@@ -0,0 +1,445 @@
+#include "resolver.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <unordered_map>
+
+static const std::vector<std::string> RestrictedWords = {
+   "template"
+};
+
+static const std::map<Type, std::string> NativeTypeMap = {
+   { Type::Double, "double" },
+   { Type::Float, "float" },
+   { Type::Int32, "int32_t" },
+   { Type::Int64, "int64_t" },
+   { Type::Uint32, "uint32_t" },
+   { Type::Uint64, "uint64_t" },
+   { Type::Sint32, "int32_t" },
+   { Type::Sint64, "int64_t" },
+   { Type::Fixed32, "uint32_t" },
+   { Type::Fixed64, "uint64_t" },
+   { Type::Sfixed32, "int32_t" },
+   { Type::Sfixed64, "int64_t" },
+   { Type::Bool, "bool" },
+   { Type::String, "std::string_view" },
+   { Type::Bytes, "std::string_view" }
+};
+
+std::string convertClassName(const std::string &in)
+{
+   std::string nativeClass = in;
+   std::string::size_type pos;
+
+   if (nativeClass.at(0) == '.') {
+      nativeClass.erase(0, 1);
+   }
+
+   while ((pos = nativeClass.find_first_of('.')) != std::string::npos) {
+      nativeClass.replace(pos, 1, "::", 2);
+   }
+
+   return nativeClass;
+}
+
+static std::string getNativeName(const std::string &name)
+{
+   if (std::find(RestrictedWords.begin(), RestrictedWords.end(), name) != RestrictedWords.end()) {
+      return name + "_";
+   }
+
+   return name;
+}
+
+namespace
+{
+
+struct Symbol
+{
+   Type type;
+
+   // The message itself, or the message an enum is nested in
+   Message *message;
+};
+
+class Resolver
+{
+public:
+   bool resolve(ProtoFile &proto)
+   {
+      for (auto &enum_ : proto.enums) {
+         declare(enum_, nullptr, "");
+      }
+
+      for (auto &msg : proto.messages) {
+         declare(msg, nullptr, "");
+      }
+
+      for (auto &msg : proto.messages) {
+         resolveFields(msg);
+      }
+
+      sortMessages(proto.messages, nullptr);
+
+      // Innermost scopes come first, moving a message keeps its children where they are
+      for (auto &order : mOrders) {
+         applyOrder(*order.first, order.second);
+      }
+
+      return !mFailed;
+   }
+
+private:
+   // All fields of a message, or of the messages nested in it, that contain
+   // a message of the same scope by value or use an enum nested in one
+   struct Dependency
+   {
+      unsigned message;
+      std::vector<Field *> fields;
+
+      // Set once the fields are pointers and no longer order the messages
+      bool broken;
+   };
+
+   enum class VisitState
+   {
+      New,
+      Active,
+      Done
+   };
+
+   void declare(Enum &enum_, Message *parent, const std::string &path)
+   {
+      enum_.nativeName = path + enum_.name;
+      mSymbols[enum_.nativeName] = { Type::Enum, parent };
+
+      for (auto &field : enum_.fields) {
+         field.nativeName = getNativeName(field.name);
+      }
+   }
+
+   void declare(Message &msg, Message *parent, const std::string &path)
+   {
+      msg.nativeName = path + msg.name;
+      mSymbols[msg.nativeName] = { Type::Message, &msg };
+      mParents[&msg] = parent;
+
+      auto scope = msg.nativeName + "::";
+
+      for (auto &field : msg.fields) {
+         field.nativeName = getNativeName(field.name);
+
+         if (field.rule == FieldRule::Map) {
+            auto keyItr = NativeTypeMap.find(field.keyType.basicType);
+            assert(keyItr != NativeTypeMap.end());
+            field.nativeKeyType = keyItr->second;
+         }
+
+         auto typeItr = NativeTypeMap.find(field.type.basicType);
+
+         if (typeItr != NativeTypeMap.end()) {
+            field.nativeType = typeItr->second;
+         }
+      }
+
+      for (auto &oneof : msg.oneofs) {
+         oneof.nativeName = getNativeName(oneof.name);
+         oneof.nativeCaseName = oneof.name + "Case";
+         oneof.nativeCaseName[0] = static_cast<char>(toupper(oneof.nativeCaseName[0]));
+      }
+
+      for (auto &enum_ : msg.enums) {
+         declare(enum_, &msg, scope);
+      }
+
+      for (auto &submsg : msg.messages) {
+         declare(submsg, &msg, scope);
+      }
+   }
+
+   // Looks name up in scope and then in each enclosing scope, like protoc
+   const std::pair<const std::string, Symbol> *lookup(std::string scope, const std::string &name)
+   {
+      auto nativeName = convertClassName(name);
+
+      if (name[0] == '.') {
+         scope.clear();
+      }
+
+      while (true) {
+         auto itr = mSymbols.find(scope + nativeName);
+
+         if (itr != mSymbols.end()) {
+            return &*itr;
+         }
+
+         if (scope.empty()) {
+            return nullptr;
+         }
+
+         // Drop the innermost name, "A::B::" becomes "A::"
+         auto pos = scope.rfind("::", scope.size() - 3);
+         scope.resize(pos == std::string::npos ? 0 : pos + 2);
+      }
+   }
+
+   bool isSelfOrAncestor(Message *candidate, Message *msg)
+   {
+      for (; msg; msg = mParents[msg]) {
+         if (msg == candidate) {
+            return true;
+         }
+      }
+
+      return false;
+   }
+
+   void resolveFields(Message &msg)
+   {
+      auto scope = msg.nativeName + "::";
+
+      for (auto &field : msg.fields) {
+         if (field.type.basicType != Type::LookupName) {
+            continue;
+         }
+
+         auto symbol = lookup(scope, field.type.className);
+
+         if (!symbol) {
+            // Declared in an imported file, which only contains messages for now
+            field.nativeAbsoluteType = convertClassName(field.type.className);
+            field.type.basicType = Type::Message;
+         } else {
+            field.nativeAbsoluteType = symbol->first;
+            field.type.basicType = symbol->second.type;
+
+            // A message can not contain itself or a message it is nested in,
+            // the enums of those are already declared
+            if (symbol->second.message) {
+               if (!isSelfOrAncestor(symbol->second.message, &msg)) {
+                  mTargets[&field] = symbol->second.message;
+               } else if (field.type.basicType == Type::Message) {
+                  field.type.basicType = Type::MessagePointer;
+               }
+            }
+         }
+
+         field.nativeType = field.nativeAbsoluteType;
+
+         if (field.nativeType.compare(0, scope.size(), scope) == 0) {
+            field.nativeType.erase(0, scope.size());
+         }
+      }
+
+      for (auto &submsg : msg.messages) {
+         resolveFields(submsg);
+      }
+   }
+
+   void collectDependencies(Message &msg, Message *scope, const std::unordered_map<const Message *, unsigned> &index,
+                            unsigned self, std::vector<Dependency> &dependencies, std::unordered_map<unsigned, size_t> &found)
+   {
+      for (auto &field : msg.fields) {
+         auto targetItr = mTargets.find(&field);
+
+         if (targetItr == mTargets.end()) {
+            continue;
+         }
+
+         // The dependency is on whichever message of this scope the target is nested in
+         auto target = targetItr->second;
+
+         while (target && mParents[target] != scope) {
+            target = mParents[target];
+         }
+
+         if (!target) {
+            continue;
+         }
+
+         auto other = index.at(target);
+
+         if (other == self) {
+            continue;
+         }
+
+         auto foundItr = found.find(other);
+
+         if (foundItr == found.end()) {
+            foundItr = found.emplace(other, dependencies.size()).first;
+            dependencies.push_back({ other, {}, false });
+         }
+
+         dependencies[foundItr->second].fields.push_back(&field);
+      }
+
+      for (auto &submsg : msg.messages) {
+         collectDependencies(submsg, scope, index, self, dependencies, found);
+      }
+   }
+
+   // A dependency can be broken when every field of it holds the message
+   // itself, which can be forward declared, rather than an enum or a message
+   // nested in it
+   bool isBreakable(Message &to, Dependency &dependency)
+   {
+      for (auto field : dependency.fields) {
+         if (field->type.basicType != Type::Message || mTargets[field] != &to) {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
+   void breakDependency(Message &to, Dependency &dependency)
+   {
+      for (auto field : dependency.fields) {
+         field->type.basicType = Type::MessagePointer;
+      }
+
+      to.forwardDeclare = true;
+      dependency.broken = true;
+   }
+
+   // Depth first topological sort of one scope, messages without dependencies
+   // between them keep their declaration order. A cycle is broken at the
+   // dependency that closes it when possible, else at any other dependency
+   // of the cycle, which invalidates the order found so far and returns
+   // false to sort again.
+   bool sortScope(std::vector<Message> &messages, std::vector<std::vector<Dependency>> &dependencies, std::vector<unsigned> &order)
+   {
+      auto count = static_cast<unsigned>(messages.size());
+      auto state = std::vector<VisitState>(count, VisitState::New);
+      auto stack = std::vector<std::pair<unsigned, size_t>> {};
+      order.clear();
+      order.reserve(count);
+
+      for (auto root = 0u; root < count; ++root) {
+         if (state[root] != VisitState::New) {
+            continue;
+         }
+
+         state[root] = VisitState::Active;
+         stack.push_back({ root, 0 });
+
+         while (!stack.empty()) {
+            auto node = stack.back().first;
+            auto next = stack.back().second++;
+
+            if (next == dependencies[node].size()) {
+               state[node] = VisitState::Done;
+               order.push_back(node);
+               stack.pop_back();
+               continue;
+            }
+
+            auto &dependency = dependencies[node][next];
+
+            if (dependency.broken) {
+               continue;
+            }
+
+            if (state[dependency.message] == VisitState::New) {
+               state[dependency.message] = VisitState::Active;
+               stack.push_back({ dependency.message, 0 });
+               continue;
+            }
+
+            if (state[dependency.message] != VisitState::Active) {
+               continue;
+            }
+
+            if (isBreakable(messages[dependency.message], dependency)) {
+               breakDependency(messages[dependency.message], dependency);
+               continue;
+            }
+
+            // The cycle runs through the stack from the message depended on,
+            // each entry depends on the next one with its last dependency
+            auto start = stack.size() - 1;
+
+            while (stack[start].first != dependency.message) {
+               --start;
+            }
+
+            for (auto i = start; i + 1 < stack.size(); ++i) {
+               auto &edge = dependencies[stack[i].first][stack[i].second - 1];
+
+               if (isBreakable(messages[edge.message], edge)) {
+                  breakDependency(messages[edge.message], edge);
+                  return false;
+               }
+            }
+
+            std::cout << "Can not break the dependency cycle between";
+
+            for (auto i = start; i < stack.size(); ++i) {
+               std::cout << (i == start ? " " : ", ") << messages[stack[i].first].nativeName;
+            }
+
+            std::cout << ", every field in it uses an enum or message nested in another message which can not be forward declared" << std::endl;
+
+            // Carry on to report every cycle
+            dependency.broken = true;
+            mFailed = true;
+         }
+      }
+
+      return true;
+   }
+
+   void sortMessages(std::vector<Message> &messages, Message *scope)
+   {
+      for (auto &msg : messages) {
+         sortMessages(msg.messages, &msg);
+      }
+
+      auto count = static_cast<unsigned>(messages.size());
+      auto index = std::unordered_map<const Message *, unsigned> {};
+      auto dependencies = std::vector<std::vector<Dependency>>(count);
+
+      for (auto i = 0u; i < count; ++i) {
+         index[&messages[i]] = i;
+      }
+
+      for (auto i = 0u; i < count; ++i) {
+         auto found = std::unordered_map<unsigned, size_t> {};
+         collectDependencies(messages[i], scope, index, i, dependencies[i], found);
+      }
+
+      auto order = std::vector<unsigned> {};
+
+      while (!sortScope(messages, dependencies, order)) {
+      }
+
+      mOrders.push_back({ &messages, std::move(order) });
+   }
+
+   void applyOrder(std::vector<Message> &messages, const std::vector<unsigned> &order)
+   {
+      auto sorted = std::vector<Message> {};
+      sorted.reserve(messages.size());
+
+      for (auto i : order) {
+         sorted.push_back(std::move(messages[i]));
+      }
+
+      messages = std::move(sorted);
+   }
+
+private:
+   std::unordered_map<std::string, Symbol> mSymbols;
+   std::unordered_map<const Message *, Message *> mParents;
+   std::unordered_map<const Field *, Message *> mTargets;
+   std::vector<std::pair<std::vector<Message> *, std::vector<unsigned>>> mOrders;
+   bool mFailed = false;
+};
+
+}
+
+bool resolveFile(ProtoFile &proto)
+{
+   auto resolver = Resolver {};
+   return resolver.resolve(proto);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "parser.h"
+
+// Converts a .proto type name such as ".pkg.Outer.Inner" to "pkg::Outer::Inner"
+std::string convertClassName(const std::string &in);
+
+// Fills in the native names and types of everything in proto, resolves the
+// message and enum types of fields and orders the messages of every scope
+// so each is declared after the messages it contains by value. Dependency
+// cycles are broken by turning fields into heap allocated MessagePointers
+// to a forward declared message. Runs in time linear in the schema size,
+// plus one more sort of a scope for each cycle that has to be broken away
+// from the dependency closing it. Fails when a cycle can not be broken.
+bool resolveFile(ProtoFile &proto);
@@ -0,0 +1,50 @@
+#include "arena.h"
+#include <algorithm>
+
+namespace pbsl
+{
+
+void *Arena::allocateSlow(size_t size, size_t alignment)
+{
+   // Blocks double in size so large messages need few of them
+   auto blockSize = std::max(mBlockSize, size + alignment);
+
+   if (!mBlocks.empty()) {
+      blockSize = std::max(blockSize, mBlocks.back().size * 2);
+   }
+
+   mBlocks.push_back({ std::unique_ptr<char[]>(new char[blockSize]), blockSize });
+   mPosition = mBlocks.back().data.get();
+   mEnd = mPosition + blockSize;
+
+   auto position = alignUp(mPosition, alignment);
+   mPosition = position + size;
+   return position;
+}
+
+void Arena::reset()
+{
+   if (mBlocks.empty()) {
+      return;
+   }
+
+   // The last block is the largest one
+   auto last = std::move(mBlocks.back());
+   mBlocks.clear();
+   mBlocks.push_back(std::move(last));
+   mPosition = mBlocks.back().data.get();
+   mEnd = mPosition + mBlocks.back().size;
+}
+
+size_t Arena::capacity() const
+{
+   auto size = size_t { 0 };
+
+   for (auto &block : mBlocks) {
+      size += block.size;
+   }
+
+   return size;
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace pbsl
+{
+
+// Bump allocator for dynamic messages. Allocations are never freed on their
+// own, reset() releases everything at once and keeps the largest block, so a
+// gateway decoding one message after another settles on a single block.
+// Nothing allocated in an arena has its destructor called.
+class Arena
+{
+public:
+   static const size_t DefaultBlockSize = 4096;
+
+   Arena(size_t blockSize = DefaultBlockSize) :
+      mPosition(nullptr),
+      mEnd(nullptr),
+      mBlockSize(blockSize)
+   {
+   }
+
+   Arena(const Arena &) = delete;
+   Arena &operator=(const Arena &) = delete;
+
+   void *allocate(size_t size, size_t alignment = alignof(uint64_t))
+   {
+      auto position = alignUp(mPosition, alignment);
+
+      if (!position || position + size > mEnd) {
+         return allocateSlow(size, alignment);
+      }
+
+      mPosition = position + size;
+      return position;
+   }
+
+   template<typename Type>
+   Type *allocateArray(size_t count)
+   {
+      return static_cast<Type *>(allocate(sizeof(Type) * count, alignof(Type)));
+   }
+
+   void reset();
+
+   // Bytes held in blocks, used or not
+   size_t capacity() const;
+
+private:
+   static char *alignUp(char *position, size_t alignment)
+   {
+      auto address = reinterpret_cast<uintptr_t>(position);
+      return reinterpret_cast<char *>((address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+   }
+
+   void *allocateSlow(size_t size, size_t alignment);
+
+private:
+   struct Block
+   {
+      std::unique_ptr<char[]> data;
+      size_t size;
+   };
+
+   std::vector<Block> mBlocks;
+   char *mPosition;
+   char *mEnd;
+   size_t mBlockSize;
+};
+
+}
@@ -0,0 +1,166 @@
+#include "dynamicmessage.h"
+#include <cstring>
+#include <new>
+
+namespace pbsl
+{
+
+DynamicMessage *DynamicMessage::parse(const DynamicMessageType &type, const std::string_view &data, Arena &arena)
+{
+   auto message = create(type, arena);
+   return message->decode(data, arena) ? message : nullptr;
+}
+
+DynamicMessage *DynamicMessage::create(const DynamicMessageType &type, Arena &arena)
+{
+   auto fieldCount = type.fields.size();
+   auto presentWords = (fieldCount + 31) / 32;
+
+   auto values = arena.allocateArray<DynamicValue>(fieldCount);
+   auto oneofCases = arena.allocateArray<uint32_t>(type.oneofCount + presentWords);
+   std::memset(values, 0, sizeof(DynamicValue) * fieldCount);
+   std::memset(oneofCases, 0, sizeof(uint32_t) * (type.oneofCount + presentWords));
+
+   auto memory = arena.allocate(sizeof(DynamicMessage), alignof(DynamicMessage));
+   return new (memory) DynamicMessage { type, values, oneofCases, oneofCases + type.oneofCount };
+}
+
+bool DynamicMessage::decode(const std::string_view &data, Arena &arena)
+{
+   auto parser = Parser { data };
+
+   while (!parser.eof()) {
+      auto tag = parser.readTag();
+      auto field = mType->findField(tag.field);
+
+      if (PBSL_UNLIKELY(!field)) {
+         parser.skipField(tag.type);
+         continue;
+      }
+
+      if (PBSL_LIKELY(tag.type == field->wireType)) {
+         auto &value = field->repeated ? append(*field, arena) : set(*field);
+
+         if (!decodeValue(parser, *field, value, arena)) {
+            return false;
+         }
+      } else if (field->packable && tag.type == Parser::WireType::LengthDelimited) {
+         auto packed = Parser { parser.readString() };
+
+         while (!packed.eof()) {
+            if (!decodeValue(packed, *field, append(*field, arena), arena)) {
+               return false;
+            }
+         }
+      } else {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool DynamicMessage::decodeValue(Parser &parser, const DynamicField &field, DynamicValue &value, Arena &arena)
+{
+   switch (field.type) {
+   case Type::Int32:
+   case Type::Enum:
+      value.integer = parser.readInt32();
+      break;
+   case Type::Int64:
+      value.integer = parser.readInt64();
+      break;
+   case Type::Sint32:
+      value.integer = parser.readSint32();
+      break;
+   case Type::Sint64:
+      value.integer = parser.readSint64();
+      break;
+   case Type::Sfixed32:
+      value.integer = parser.readSfixed32();
+      break;
+   case Type::Sfixed64:
+      value.integer = parser.readSfixed64();
+      break;
+   case Type::Uint32:
+      value.unsignedInteger = parser.readUint32();
+      break;
+   case Type::Uint64:
+      value.unsignedInteger = parser.readUint64();
+      break;
+   case Type::Fixed32:
+      value.unsignedInteger = parser.readFixed32();
+      break;
+   case Type::Fixed64:
+      value.unsignedInteger = parser.readFixed64();
+      break;
+   case Type::Bool:
+      value.unsignedInteger = parser.readBool();
+      break;
+   case Type::Float:
+      value.real = parser.readFloat();
+      break;
+   case Type::Double:
+      value.real = parser.readDouble();
+      break;
+   case Type::String:
+   case Type::Bytes:
+   {
+      auto string = parser.readString();
+      value.string = { string.data(), string.size() };
+      break;
+   }
+   case Type::Message:
+      // A singular message occurring again is merged into, like parse() does
+      if (!value.message) {
+         value.message = create(*field.message, arena);
+      }
+
+      return value.message->decode(parser.readMessage(), arena);
+   default:
+      assert(0 && "Unsupported field type!");
+      return false;
+   }
+
+   return true;
+}
+
+DynamicValue &DynamicMessage::set(const DynamicField &field)
+{
+   if (field.oneofIndex >= 0) {
+      // Another alternative was set since, a message is not merged into
+      if (mOneofCases[field.oneofIndex] != field.index + 1) {
+         std::memset(&mValues[field.index], 0, sizeof(DynamicValue));
+      }
+
+      mOneofCases[field.oneofIndex] = field.index + 1;
+   } else {
+      mPresent[field.index / 32] |= 1u << (field.index % 32);
+   }
+
+   return mValues[field.index];
+}
+
+DynamicValue &DynamicMessage::append(const DynamicField &field, Arena &arena)
+{
+   auto &list = mValues[field.index].list;
+
+   // Grown by copying into a larger array, the old one stays in the arena
+   if (list.size == list.capacity) {
+      auto capacity = list.capacity ? list.capacity * 2 : 4;
+      auto items = arena.allocateArray<DynamicValue>(capacity);
+
+      if (list.size) {
+         std::memcpy(items, list.items, sizeof(DynamicValue) * list.size);
+      }
+
+      list.items = items;
+      list.capacity = capacity;
+   }
+
+   auto &value = list.items[list.size++];
+   std::memset(&value, 0, sizeof(value));
+   return value;
+}
+
+}
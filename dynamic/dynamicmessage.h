@@ -0,0 +1,157 @@
+#pragma once
+#include <cassert>
+#include <stdint.h>
+#include <string_view.h>
+#include "arena.h"
+#include "dynamicschema.h"
+
+namespace pbsl
+{
+
+class DynamicMessage;
+union DynamicValue;
+
+struct DynamicString
+{
+   const char *data;
+   size_t size;
+};
+
+struct DynamicList
+{
+   DynamicValue *items;
+   uint32_t size;
+   uint32_t capacity;
+};
+
+// Value of a field, which member is used depends on the field type:
+//  - integer: int32, int64, sint, sfixed and enum fields
+//  - unsignedInteger: uint32, uint64, fixed and bool fields
+//  - real: float and double fields
+//  - string: string and bytes fields
+//  - message: message fields and map entries
+// Repeated and map fields hold their elements in list.
+union DynamicValue
+{
+   int64_t integer;
+   uint64_t unsignedInteger;
+   double real;
+   DynamicString string;
+   DynamicMessage *message;
+   DynamicList list;
+};
+
+// Message of a runtime type, decoded into an arena. Strings and bytes point
+// into the decoded data like they do in generated messages, so the data has
+// to outlive the message. Unknown fields are skipped, a singular field
+// occurring again replaces the earlier value except for sub messages, which
+// are merged like generated messages merge them.
+class DynamicMessage
+{
+public:
+   // Returns nullptr when a field has the wrong wire type or a sub message
+   // fails to decode
+   static DynamicMessage *parse(const DynamicMessageType &type, const std::string_view &data, Arena &arena);
+
+   // Empty message of the given type
+   static DynamicMessage *create(const DynamicMessageType &type, Arena &arena);
+
+   const DynamicMessageType &type() const
+   {
+      return *mType;
+   }
+
+   // Whether a singular field was decoded, or a repeated field has elements
+   bool has(const DynamicField &field) const
+   {
+      if (field.repeated) {
+         return mValues[field.index].list.size != 0;
+      }
+
+      if (field.oneofIndex >= 0) {
+         return mOneofCases[field.oneofIndex] == field.index + 1;
+      }
+
+      return (mPresent[field.index / 32] >> (field.index % 32)) & 1;
+   }
+
+   // Number of elements of a repeated field, 1 or 0 for singular fields
+   size_t size(const DynamicField &field) const
+   {
+      return field.repeated ? mValues[field.index].list.size : (has(field) ? 1 : 0);
+   }
+
+   // The field of a oneof that is set, or nullptr
+   const DynamicField *oneofField(unsigned oneof) const
+   {
+      auto index = mOneofCases[oneof];
+      return index ? &mType->fields[index - 1] : nullptr;
+   }
+
+   // Unset fields read as 0, an empty string or nullptr. The index selects
+   // an element of a repeated field and is ignored for singular fields.
+   const DynamicValue &value(const DynamicField &field, size_t index = 0) const
+   {
+      assert(&mType->fields[field.index] == &field);
+
+      if (field.repeated) {
+         assert(index < mValues[field.index].list.size);
+         return mValues[field.index].list.items[index];
+      }
+
+      return mValues[field.index];
+   }
+
+   int64_t getInteger(const DynamicField &field, size_t index = 0) const
+   {
+      return value(field, index).integer;
+   }
+
+   uint64_t getUnsigned(const DynamicField &field, size_t index = 0) const
+   {
+      return value(field, index).unsignedInteger;
+   }
+
+   double getReal(const DynamicField &field, size_t index = 0) const
+   {
+      return value(field, index).real;
+   }
+
+   bool getBool(const DynamicField &field, size_t index = 0) const
+   {
+      return value(field, index).unsignedInteger != 0;
+   }
+
+   std::string_view getString(const DynamicField &field, size_t index = 0) const
+   {
+      auto &string = value(field, index).string;
+      return { string.data, string.size };
+   }
+
+   const DynamicMessage *getMessage(const DynamicField &field, size_t index = 0) const
+   {
+      return value(field, index).message;
+   }
+
+private:
+   DynamicMessage(const DynamicMessageType &type, DynamicValue *values, uint32_t *oneofCases, uint32_t *present) :
+      mType(&type),
+      mValues(values),
+      mOneofCases(oneofCases),
+      mPresent(present)
+   {
+   }
+
+   bool decode(const std::string_view &data, Arena &arena);
+   bool decodeValue(Parser &parser, const DynamicField &field, DynamicValue &value, Arena &arena);
+   DynamicValue &set(const DynamicField &field);
+   DynamicValue &append(const DynamicField &field, Arena &arena);
+
+private:
+   const DynamicMessageType *mType;
+   DynamicValue *mValues;
+   uint32_t *mOneofCases;
+   uint32_t *mPresent;
+};
+
+}
@@ -0,0 +1,235 @@
+#include "dynamicschema.h"
+#include "resolver.h"
+#include <algorithm>
+#include <iostream>
+
+namespace pbsl
+{
+
+static unsigned getWireType(Type type)
+{
+   switch (type) {
+   case Type::Double:
+   case Type::Fixed64:
+   case Type::Sfixed64:
+      return Parser::WireType::Fixed64;
+   case Type::Float:
+   case Type::Fixed32:
+   case Type::Sfixed32:
+      return Parser::WireType::Fixed32;
+   case Type::String:
+   case Type::Bytes:
+   case Type::Message:
+      return Parser::WireType::LengthDelimited;
+   default:
+      return Parser::WireType::VarInt;
+   }
+}
+
+// Builds the field number lookup tables once all fields are known
+static void compileLookup(DynamicMessageType &type)
+{
+   auto maxDense = 0u;
+
+   for (auto &field : type.fields) {
+      if (field.number < DynamicMessageType::DenseFieldLimit) {
+         maxDense = std::max(maxDense, field.number);
+      }
+   }
+
+   type.denseFields.assign(maxDense + 1, 0);
+
+   for (auto &field : type.fields) {
+      if (field.number < DynamicMessageType::DenseFieldLimit) {
+         type.denseFields[field.number] = static_cast<uint16_t>(field.index + 1);
+      } else {
+         type.sparseFields.emplace_back(field.number, field.index);
+      }
+   }
+
+   std::sort(type.sparseFields.begin(), type.sparseFields.end());
+}
+
+const DynamicField *DynamicMessageType::findSparseField(unsigned number) const
+{
+   auto itr = std::lower_bound(sparseFields.begin(), sparseFields.end(), std::make_pair(number, 0u));
+
+   if (itr == sparseFields.end() || itr->first != number) {
+      return nullptr;
+   }
+
+   return &fields[itr->second];
+}
+
+const DynamicField *DynamicMessageType::findField(const std::string &name) const
+{
+   for (auto &field : fields) {
+      if (field.name == name) {
+         return &field;
+      }
+   }
+
+   return nullptr;
+}
+
+bool DynamicSchema::load(const std::string &path)
+{
+   auto files = std::vector<ProtoFile> {};
+
+   if (!parse(path, files)) {
+      return false;
+   }
+
+   for (auto &proto : files) {
+      if (!resolveFile(proto)) {
+         return false;
+      }
+
+      for (auto &msg : proto.messages) {
+         declare(msg);
+      }
+   }
+
+   for (auto &proto : files) {
+      for (auto &msg : proto.messages) {
+         if (!compile(msg)) {
+            return false;
+         }
+      }
+   }
+
+   return true;
+}
+
+const DynamicMessageType *DynamicSchema::find(const std::string &name) const
+{
+   auto itr = mTypesByName.find(name.find('.') != std::string::npos ? convertClassName(name) : name);
+   return itr != mTypesByName.end() ? itr->second : nullptr;
+}
+
+bool DynamicSchema::parse(const std::string &path, std::vector<ProtoFile> &files)
+{
+   if (!mLoadedFiles.insert(path).second) {
+      return true;
+   }
+
+   auto proto = ProtoFile {};
+
+   if (!parseFileFast(path, proto)) {
+      mLoadedFiles.erase(path);
+      return false;
+   }
+
+   auto slash = path.find_last_of("/\\");
+   auto directory = slash == std::string::npos ? std::string {} : path.substr(0, slash + 1);
+
+   for (auto &import : proto.imports) {
+      if (!parse(directory + import.file, files)) {
+         return false;
+      }
+   }
+
+   files.push_back(std::move(proto));
+   return true;
+}
+
+void DynamicSchema::declare(Message &msg)
+{
+   mTypes.emplace_back();
+   mTypes.back().name = msg.nativeName;
+   mTypesByName[msg.nativeName] = &mTypes.back();
+
+   for (auto &submsg : msg.messages) {
+      declare(submsg);
+   }
+}
+
+bool DynamicSchema::compile(Message &msg)
+{
+   auto &type = *mTypesByName[msg.nativeName];
+   type.oneofCount = static_cast<unsigned>(msg.oneofs.size());
+   type.fields.resize(msg.fields.size());
+
+   for (auto i = 0u; i < msg.fields.size(); ++i) {
+      type.fields[i].index = i;
+
+      if (!compileField(msg.fields[i], type.fields[i], type)) {
+         return false;
+      }
+   }
+
+   compileLookup(type);
+
+   for (auto &submsg : msg.messages) {
+      if (!compile(submsg)) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool DynamicSchema::compileField(Field &field, DynamicField &result, DynamicMessageType &type)
+{
+   result.name = field.name;
+   result.number = static_cast<unsigned>(std::stoul(field.value));
+   result.type = field.type.basicType == Type::MessagePointer ? Type::Message : field.type.basicType;
+   result.repeated = field.rule == FieldRule::Repeated || field.rule == FieldRule::Map;
+   result.oneofIndex = field.oneofIndex;
+   result.message = nullptr;
+
+   if (field.rule == FieldRule::Map) {
+      // Entries are decoded as a message of their own
+      mTypes.emplace_back();
+      auto &entry = mTypes.back();
+      entry.name = type.name + "::" + field.name + "Entry";
+
+      auto key = Field {};
+      key.type = field.keyType;
+      key.name = "key";
+      key.value = "1";
+
+      auto value = field;
+      value.rule = FieldRule::None;
+      value.name = "value";
+      value.value = "2";
+
+      entry.fields.resize(2);
+      entry.fields[0].index = 0;
+      entry.fields[1].index = 1;
+
+      if (!compileField(key, entry.fields[0], entry) || !compileField(value, entry.fields[1], entry)) {
+         return false;
+      }
+
+      compileLookup(entry);
+      result.type = Type::Message;
+      result.message = &entry;
+   } else if (result.type == Type::Message) {
+      // Fields of imported messages keep the package of their type name,
+      // which is not part of the name the message was declared with
+      auto name = field.nativeAbsoluteType;
+      auto itr = mTypesByName.find(name);
+
+      while (itr == mTypesByName.end() && name.find("::") != std::string::npos) {
+         name.erase(0, name.find("::") + 2);
+         itr = mTypesByName.find(name);
+      }
+
+      if (itr == mTypesByName.end()) {
+         std::cout << "Unknown message type " << field.nativeAbsoluteType << " of " << type.name << "." << field.name << std::endl;
+         return false;
+      }
+
+      result.message = itr->second;
+   } else if (result.type == Type::LookupName || result.type == Type::Invalid) {
+      std::cout << "Unknown type " << field.type.className << " of " << type.name << "." << field.name << std::endl;
+      return false;
+   }
+
+   result.wireType = getWireType(result.type);
+   result.packable = result.repeated && field.rule != FieldRule::Map && result.wireType != Parser::WireType::LengthDelimited;
+   return true;
+}
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <pbsl/parser.h>
+#include "parser.h"
+
+namespace pbsl
+{
+
+struct DynamicMessageType;
+
+struct DynamicField
+{
+   std::string name;
+   unsigned number;
+
+   // Message for message fields and map entries, MessagePointer is folded
+   // into Message as every dynamic sub message lives in the arena
+   Type type;
+
+   // Wire type of a single value, checked against every tag
+   unsigned wireType;
+
+   // Repeated and map fields, map entries are messages with the key as
+   // field 1 and the value as field 2
+   bool repeated;
+
+   // Repeated scalars, which may also arrive packed in one record
+   bool packable;
+
+   int oneofIndex;
+
+   // Position in DynamicMessageType::fields and of the value in a message
+   unsigned index;
+
+   const DynamicMessageType *message;
+};
+
+// A message type compiled into decode tables
+struct DynamicMessageType
+{
+   // Field numbers up to this are looked up in a dense table
+   static const unsigned DenseFieldLimit = 1024;
+
+   std::string name;
+   std::vector<DynamicField> fields;
+   unsigned oneofCount = 0;
+
+   // Index + 1 of the field by field number, 0 for unknown fields
+   std::vector<uint16_t> denseFields;
+
+   // Field numbers past the dense table and their index, sorted
+   std::vector<std::pair<unsigned, unsigned>> sparseFields;
+
+   const DynamicField *findField(unsigned number) const
+   {
+      if (PBSL_LIKELY(number < denseFields.size())) {
+         auto index = denseFields[number];
+         return index ? &fields[index - 1] : nullptr;
+      }
+
+      return findSparseField(number);
+   }
+
+   const DynamicField *findField(const std::string &name) const;
+
+private:
+   const DynamicField *findSparseField(unsigned number) const;
+};
+
+// Message types loaded from .proto files at runtime, read with the same
+// frontend and resolver as the compiler. Types are named like the generated
+// classes, "Outer::Inner", or with dots, "Outer.Inner".
+class DynamicSchema
+{
+public:
+   // Loads a .proto file and the files it imports, relative to its
+   // directory. Fails when a file can not be parsed, has a dependency cycle
+   // that can not be broken or a field refers to a message that is not
+   // loaded.
+   bool load(const std::string &path);
+
+   const DynamicMessageType *find(const std::string &name) const;
+
+private:
+   bool parse(const std::string &path, std::vector<ProtoFile> &files);
+   void declare(Message &msg);
+   bool compile(Message &msg);
+   bool compileField(Field &field, DynamicField &result, DynamicMessageType &type);
+
+private:
+   // Deques keep the address of types stable as more are loaded
+   std::deque<DynamicMessageType> mTypes;
+   std::unordered_map<std::string, DynamicMessageType *> mTypesByName;
+   std::set<std::string> mLoadedFiles;
+};
+
+}
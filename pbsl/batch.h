@@ -0,0 +1,157 @@
+#pragma once
+#include <pbsl/parser.h>
+#include <algorithm>
+#include <cstddef>
+#include <string_view.h>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <xmmintrin.h>
+#endif
+
+// Cache prefetch hints, no-ops where the compiler has none
+#if defined(__GNUC__) || defined(__clang__)
+#define PBSL_PREFETCH(address) __builtin_prefetch(address, 0)
+#define PBSL_PREFETCH_WRITE(address) __builtin_prefetch(address, 1)
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define PBSL_PREFETCH(address) _mm_prefetch(reinterpret_cast<const char *>(address), _MM_HINT_T0)
+#define PBSL_PREFETCH_WRITE(address) _mm_prefetch(reinterpret_cast<const char *>(address), _MM_HINT_T0)
+#else
+#define PBSL_PREFETCH(address)
+#define PBSL_PREFETCH_WRITE(address)
+#endif
+
+namespace pbsl
+{
+
+// Records decoded at the same time, one field of each in turn
+static const size_t DefaultBatchLanes = 4;
+
+// Records prefetched ahead of the ones being decoded. Far enough to cover a
+// miss to memory while decoding small messages, close enough that the
+// prefetched lines are still in cache when their turn comes.
+static const size_t DefaultPrefetchDistance = 4;
+
+// Bytes of a record and of its message prefetched, the start of a message
+// is what parse() touches first and larger records stream in behind it
+static const size_t PrefetchLimit = 256;
+
+static const size_t CacheLineSize = 64;
+
+inline void prefetchRange(const void *data, size_t size)
+{
+   auto begin = static_cast<const char *>(data);
+   auto end = begin + std::min(size, PrefetchLimit);
+
+   for (auto line = begin; line < end; line += CacheLineSize) {
+      PBSL_PREFETCH(line);
+   }
+}
+
+inline void prefetchRangeForWrite(void *data, size_t size)
+{
+   auto begin = static_cast<char *>(data);
+   auto end = begin + std::min(size, PrefetchLimit);
+
+   for (auto line = begin; line < end; line += CacheLineSize) {
+      PBSL_PREFETCH_WRITE(line);
+   }
+}
+
+// A record being decoded by parseBatch()
+struct BatchLane
+{
+   Parser parser;
+   size_t index;
+};
+
+// Parses records[i] into messages[i] for a batch of independent records,
+// such as the ones taken from a receive ring. Calling parse() one record
+// after another stalls on every record and message that is not in cache, and
+// each field of a record depends on the position the previous one left. Here
+// lanes records are decoded at once, one parseField() of each in turn, so
+// the loads of one lane overlap the decoding of the others, while the
+// records and messages distance places behind the newest lane are
+// prefetched. Every message is reset before its record is decoded. Stores
+// the result of every parse in results unless it is null and returns how
+// many records parsed.
+template<typename Type>
+size_t parseBatch(const std::string_view *records, size_t count, Type *messages, bool *results = nullptr, size_t distance = DefaultPrefetchDistance, size_t lanes = DefaultBatchLanes)
+{
+   lanes = std::max(std::min(lanes, count), size_t { 1 });
+   auto window = std::min(lanes + distance, count);
+
+   for (auto i = size_t { 0 }; i < window; ++i) {
+      prefetchRange(records[i].data(), records[i].size());
+      prefetchRangeForWrite(messages + i, sizeof(Type));
+   }
+
+   auto active = std::vector<BatchLane> {};
+   auto next = size_t { 0 };
+   auto parsed = size_t { 0 };
+
+   // Hands the next record to lane and prefetches the one window places on
+   auto start = [&](BatchLane &lane) {
+      lane.parser = Parser { records[next] };
+      lane.index = next;
+      messages[next] = Type {};
+
+      if (next + window < count) {
+         auto &ahead = records[next + window];
+         prefetchRange(ahead.data(), ahead.size());
+         prefetchRangeForWrite(messages + next + window, sizeof(Type));
+      }
+
+      next++;
+   };
+
+   active.reserve(lanes);
+
+   while (active.size() < lanes && next < count) {
+      active.push_back(BatchLane { Parser { std::string_view {} }, 0 });
+      start(active.back());
+   }
+
+   while (active.size()) {
+      for (auto lane = size_t { 0 }; lane < active.size();) {
+         auto &current = active[lane];
+         auto result = true;
+
+         if (!current.parser.eof()) {
+            result = messages[current.index].parseField(current.parser);
+
+            if (result) {
+               ++lane;
+               continue;
+            }
+         }
+
+         if (results) {
+            results[current.index] = result;
+         }
+
+         parsed += result ? 1 : 0;
+
+         if (next < count) {
+            start(current);
+            ++lane;
+         } else {
+            // Keeps the remaining lanes packed, lane now holds the last one
+            current = active.back();
+            active.pop_back();
+         }
+      }
+   }
+
+   return parsed;
+}
+
+// Resizes messages to one per record
+template<typename Type>
+size_t parseBatch(const std::vector<std::string_view> &records, std::vector<Type> &messages, size_t distance = DefaultPrefetchDistance, size_t lanes = DefaultBatchLanes)
+{
+   messages.resize(records.size());
+   return parseBatch(records.data(), records.size(), messages.data(), nullptr, distance, lanes);
+}
+
+}
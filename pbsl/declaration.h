@@ -1,7 +1,35 @@
 #pragma once
 
 // This is everything needed by the pbsl generted header files
+#include <cstddef>
 #include <stdint.h>
 #include <vector>
 #include <memory>
 #include <string_view.h>
+#include <pbsl/flatmap.h>
+#include <pbsl/oneof.h>
+#include <pbsl/packedview.h>
+
+namespace pbsl
+{
+
+class Parser;
+class StringPool;
+class Writer;
+enum class VisitResult;
+
+// Size of a message stored by byteSize() for serializeCached(). Starts out
+// at 0 rather than uninitialised, keeping messages aggregates. byteSize()
+// writes it through a const message, so one message must not be serialized
+// by several threads at once.
+struct CachedSize
+{
+   CachedSize() :
+      value(0)
+   {
+   }
+
+   size_t value;
+};
+
+}
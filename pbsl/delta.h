@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <pbsl/parser.h>
+#include <pbsl/writer.h>
+
+namespace pbsl
+{
+
+// A delta between two versions of a message, as written by the generated
+// T::diff(from, to, writer) and merged by T::applyDelta(data), is encoded in
+// the regular wire format and contains only the fields that changed:
+//  - Scalar and string fields are written with their new value.
+//  - Sub messages are written as a nested delta against their old value,
+//    or against a default constructed message when they were not set.
+//  - Repeated and map fields are replaced as a whole, a tombstone followed
+//    by every element.
+//  - Clearing a field, a message pointer or a oneof writes a tombstone. That
+//    is the field number with the EndGroup wire type, which has no payload
+//    and is otherwise unused as groups are not supported.
+static const unsigned TombstoneWireType = Parser::WireType::EndGroup;
+
+inline void writeTombstone(Writer &writer, unsigned field)
+{
+   writer.writeTag(field, TombstoneWireType);
+}
+
+template<typename Type>
+const Type &defaultValue()
+{
+   static const Type value {};
+   return value;
+}
+
+template<typename Type>
+void writeMessageDelta(Writer &writer, unsigned field, const Type &from, const Type &to)
+{
+   auto nested = std::string {};
+   auto nestedWriter = Writer { nested };
+
+   Type::diff(from, to, nestedWriter);
+   writer.writeTag(field, Parser::WireType::LengthDelimited);
+   writer.writeMessage(nested);
+}
+
+// A whole message is the delta against its default value
+template<typename Type>
+void writeMessageDelta(Writer &writer, unsigned field, const Type &value)
+{
+   writeMessageDelta(writer, field, defaultValue<Type>(), value);
+}
+
+template<typename Type>
+std::string diff(const Type &from, const Type &to)
+{
+   auto delta = std::string {};
+   auto writer = Writer { delta };
+   Type::diff(from, to, writer);
+   return delta;
+}
+
+}
@@ -0,0 +1,277 @@
+#pragma once
+#include <cassert>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include <string_view.h>
+#include <pbsl/hash.h>
+
+namespace pbsl
+{
+
+template<typename Key>
+struct FlatMapHash
+{
+   size_t operator()(const Key &key) const
+   {
+      return static_cast<size_t>(hashValue(key));
+   }
+};
+
+// Open addressing hash map with linear probing. The entries are stored inline
+// in one contiguous array and whether a slot is used in a separate byte array,
+// so a lookup touches at least two cache lines: the flags of its probe run,
+// which usually share one line, and the entries whose keys it compares.
+template<typename Key, typename Value, typename Hash = FlatMapHash<Key>>
+class FlatMap
+{
+public:
+   using key_type = Key;
+   using mapped_type = Value;
+   using value_type = std::pair<Key, Value>;
+
+   template<typename Entry, typename Owner>
+   class IteratorBase
+   {
+   public:
+      IteratorBase(Owner *map, size_t index) :
+         mMap(map),
+         mIndex(index)
+      {
+         skipEmpty();
+      }
+
+      Entry &operator*() const
+      {
+         return mMap->mEntries[mIndex];
+      }
+
+      Entry *operator->() const
+      {
+         return &mMap->mEntries[mIndex];
+      }
+
+      IteratorBase &operator++()
+      {
+         ++mIndex;
+         skipEmpty();
+         return *this;
+      }
+
+      bool operator==(const IteratorBase &other) const
+      {
+         return mIndex == other.mIndex;
+      }
+
+      bool operator!=(const IteratorBase &other) const
+      {
+         return mIndex != other.mIndex;
+      }
+
+   private:
+      void skipEmpty()
+      {
+         while (mIndex < mMap->mUsed.size() && !mMap->mUsed[mIndex]) {
+            ++mIndex;
+         }
+      }
+
+   private:
+      Owner *mMap;
+      size_t mIndex;
+   };
+
+   using iterator = IteratorBase<value_type, FlatMap>;
+   using const_iterator = IteratorBase<const value_type, const FlatMap>;
+
+   static const size_t MinCapacity = 8;
+
+public:
+   size_t size() const
+   {
+      return mSize;
+   }
+
+   bool empty() const
+   {
+      return mSize == 0;
+   }
+
+   size_t capacity() const
+   {
+      return mUsed.size();
+   }
+
+   // Ensure count entries can be stored without rehashing
+   void reserve(size_t count)
+   {
+      auto capacity = MinCapacity;
+
+      while (capacity * 3 < count * 4) {
+         capacity *= 2;
+      }
+
+      if (capacity > mUsed.size()) {
+         rehash(capacity);
+      }
+   }
+
+   void clear()
+   {
+      for (auto i = 0u; i < mUsed.size(); ++i) {
+         if (mUsed[i]) {
+            mEntries[i] = value_type {};
+            mUsed[i] = 0;
+         }
+      }
+
+      mSize = 0;
+   }
+
+   iterator begin()
+   {
+      return { this, 0 };
+   }
+
+   iterator end()
+   {
+      return { this, mUsed.size() };
+   }
+
+   const_iterator begin() const
+   {
+      return { this, 0 };
+   }
+
+   const_iterator end() const
+   {
+      return { this, mUsed.size() };
+   }
+
+   iterator find(const Key &key)
+   {
+      return { this, findIndex(key) };
+   }
+
+   const_iterator find(const Key &key) const
+   {
+      return { this, findIndex(key) };
+   }
+
+   size_t count(const Key &key) const
+   {
+      return findIndex(key) != mUsed.size() ? 1 : 0;
+   }
+
+   // Returns the entry for key, default constructing it if it does not exist
+   std::pair<iterator, bool> try_emplace(const Key &key)
+   {
+      if ((mSize + 1) * 4 > mUsed.size() * 3) {
+         rehash(mUsed.size() ? mUsed.size() * 2 : MinCapacity);
+      }
+
+      auto mask = mUsed.size() - 1;
+      auto index = Hash {}(key) & mask;
+
+      while (mUsed[index]) {
+         if (mEntries[index].first == key) {
+            return { iterator { this, index }, false };
+         }
+
+         index = (index + 1) & mask;
+      }
+
+      mUsed[index] = 1;
+      mEntries[index].first = key;
+      ++mSize;
+      return { iterator { this, index }, true };
+   }
+
+   Value &operator[](const Key &key)
+   {
+      return try_emplace(key).first->second;
+   }
+
+   size_t erase(const Key &key)
+   {
+      auto hole = findIndex(key);
+
+      if (hole == mUsed.size()) {
+         return 0;
+      }
+
+      // Backward shift deletion keeps probe sequences intact without tombstones
+      auto mask = mUsed.size() - 1;
+      auto next = (hole + 1) & mask;
+
+      while (mUsed[next]) {
+         auto home = Hash {}(mEntries[next].first) & mask;
+
+         if (((next - home) & mask) >= ((next - hole) & mask)) {
+            mEntries[hole] = std::move(mEntries[next]);
+            hole = next;
+         }
+
+         next = (next + 1) & mask;
+      }
+
+      mEntries[hole] = value_type {};
+      mUsed[hole] = 0;
+      --mSize;
+      return 1;
+   }
+
+private:
+   size_t findIndex(const Key &key) const
+   {
+      if (mSize == 0) {
+         return mUsed.size();
+      }
+
+      auto mask = mUsed.size() - 1;
+      auto index = Hash {}(key) & mask;
+
+      while (mUsed[index]) {
+         if (mEntries[index].first == key) {
+            return index;
+         }
+
+         index = (index + 1) & mask;
+      }
+
+      return mUsed.size();
+   }
+
+   void rehash(size_t capacity)
+   {
+      assert((capacity & (capacity - 1)) == 0);
+      auto entries = std::vector<value_type>(capacity);
+      auto used = std::vector<uint8_t>(capacity, 0);
+      auto mask = capacity - 1;
+
+      for (auto i = 0u; i < mUsed.size(); ++i) {
+         if (!mUsed[i]) {
+            continue;
+         }
+
+         auto index = Hash {}(mEntries[i].first) & mask;
+
+         while (used[index]) {
+            index = (index + 1) & mask;
+         }
+
+         entries[index] = std::move(mEntries[i]);
+         used[index] = 1;
+      }
+
+      mEntries.swap(entries);
+      mUsed.swap(used);
+   }
+
+private:
+   std::vector<value_type> mEntries;
+   std::vector<uint8_t> mUsed;
+   size_t mSize = 0;
+};
+
+}
@@ -0,0 +1,372 @@
+#pragma once
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <string_view.h>
+
+namespace pbsl
+{
+
+template<typename Key, typename Value, typename Hash> class FlatMap;
+template<typename... Types> class Oneof;
+template<typename Type> class PackedView;
+
+namespace detail
+{
+
+static const uint64_t Prime1 = 0x9e3779b185ebca87ull;
+static const uint64_t Prime2 = 0xc2b2ae3d27d4eb4full;
+static const uint64_t Prime3 = 0x165667b19e3779f9ull;
+static const uint64_t Prime4 = 0x85ebca77c2b2ae63ull;
+static const uint64_t Prime5 = 0x27d4eb2f165667c5ull;
+
+inline uint64_t rotl(uint64_t value, unsigned bits)
+{
+   return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t read64(const uint8_t *data)
+{
+   uint64_t value;
+   std::memcpy(&value, data, sizeof(value));
+   return value;
+}
+
+inline uint32_t read32(const uint8_t *data)
+{
+   uint32_t value;
+   std::memcpy(&value, data, sizeof(value));
+   return value;
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input)
+{
+   acc += input * Prime2;
+   acc = rotl(acc, 31);
+   return acc * Prime1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t value)
+{
+   acc ^= round(0, value);
+   return acc * Prime1 + Prime4;
+}
+
+inline uint64_t mix(uint64_t value)
+{
+   value ^= value >> 33;
+   value *= 0xff51afd7ed558ccdull;
+   value ^= value >> 33;
+   value *= 0xc4ceb9fe1a85ec53ull;
+   value ^= value >> 33;
+   return value;
+}
+
+}
+
+// xxHash64. The four accumulators of the bulk loop do not depend on each
+// other so they are pipelined or kept in vector registers by the compiler.
+inline uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 0)
+{
+   using namespace detail;
+   auto ptr = static_cast<const uint8_t *>(data);
+   auto end = ptr + size;
+   auto hash = uint64_t { 0 };
+
+   if (size >= 32) {
+      auto v1 = seed + Prime1 + Prime2;
+      auto v2 = seed + Prime2;
+      auto v3 = seed;
+      auto v4 = seed - Prime1;
+
+      do {
+         v1 = round(v1, read64(ptr));
+         v2 = round(v2, read64(ptr + 8));
+         v3 = round(v3, read64(ptr + 16));
+         v4 = round(v4, read64(ptr + 24));
+         ptr += 32;
+      } while (ptr + 32 <= end);
+
+      hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+      hash = mergeRound(hash, v1);
+      hash = mergeRound(hash, v2);
+      hash = mergeRound(hash, v3);
+      hash = mergeRound(hash, v4);
+   } else {
+      hash = seed + Prime5;
+   }
+
+   hash += size;
+
+   for (; ptr + 8 <= end; ptr += 8) {
+      hash ^= round(0, read64(ptr));
+      hash = rotl(hash, 27) * Prime1 + Prime4;
+   }
+
+   if (ptr + 4 <= end) {
+      hash ^= read32(ptr) * Prime1;
+      hash = rotl(hash, 23) * Prime2 + Prime3;
+      ptr += 4;
+   }
+
+   for (; ptr < end; ++ptr) {
+      hash ^= *ptr * Prime5;
+      hash = rotl(hash, 11) * Prime1;
+   }
+
+   hash ^= hash >> 33;
+   hash *= Prime2;
+   hash ^= hash >> 29;
+   hash *= Prime3;
+   hash ^= hash >> 32;
+   return hash;
+}
+
+inline uint64_t hashCombine(uint64_t seed, uint64_t value)
+{
+   return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+// True when the members first..last are laid out with no padding between
+// them, so the run can be hashed and compared as a single block of bytes.
+template<typename First, typename Last>
+bool isContiguous(const First &first, const Last &last, size_t size)
+{
+   auto begin = reinterpret_cast<const char *>(&first);
+   auto end = reinterpret_cast<const char *>(&last) + sizeof(Last);
+   return static_cast<size_t>(end - begin) == size;
+}
+
+// Hashing and equality of decoded field values. Floating point values are
+// compared by bit pattern so equality stays consistent with the hash.
+template<typename Type>
+typename std::enable_if<std::is_arithmetic<Type>::value || std::is_enum<Type>::value, uint64_t>::type
+hashValue(const Type &value);
+inline uint64_t hashValue(const std::string_view &value);
+template<typename Type>
+auto hashValue(const Type &value) -> decltype(value.hash());
+template<typename Type>
+uint64_t hashValue(const std::unique_ptr<Type> &value);
+template<typename Type>
+uint64_t hashValue(const std::vector<Type> &value);
+template<typename Key, typename Value, typename Hash>
+uint64_t hashValue(const FlatMap<Key, Value, Hash> &value);
+template<typename... Types>
+uint64_t hashValue(const Oneof<Types...> &value);
+template<typename Type>
+uint64_t hashValue(const PackedView<Type> &value);
+
+template<typename Type>
+typename std::enable_if<std::is_arithmetic<Type>::value || std::is_enum<Type>::value, bool>::type
+equalValue(const Type &lhs, const Type &rhs);
+inline bool equalValue(const std::string_view &lhs, const std::string_view &rhs);
+template<typename Type>
+auto equalValue(const Type &lhs, const Type &rhs) -> decltype(lhs.hash(), true);
+template<typename Type>
+bool equalValue(const std::unique_ptr<Type> &lhs, const std::unique_ptr<Type> &rhs);
+template<typename Type>
+bool equalValue(const std::vector<Type> &lhs, const std::vector<Type> &rhs);
+template<typename Key, typename Value, typename Hash>
+bool equalValue(const FlatMap<Key, Value, Hash> &lhs, const FlatMap<Key, Value, Hash> &rhs);
+template<typename... Types>
+bool equalValue(const Oneof<Types...> &lhs, const Oneof<Types...> &rhs);
+template<typename Type>
+bool equalValue(const PackedView<Type> &lhs, const PackedView<Type> &rhs);
+
+template<typename Type>
+typename std::enable_if<std::is_arithmetic<Type>::value || std::is_enum<Type>::value, uint64_t>::type
+hashValue(const Type &value)
+{
+   uint64_t bits = 0;
+   std::memcpy(&bits, &value, sizeof(Type));
+   return detail::mix(bits);
+}
+
+inline uint64_t hashValue(const std::string_view &value)
+{
+   return hashBytes(value.data(), value.size());
+}
+
+template<typename Type>
+auto hashValue(const Type &value) -> decltype(value.hash())
+{
+   return value.hash();
+}
+
+template<typename Type>
+uint64_t hashValue(const std::unique_ptr<Type> &value)
+{
+   return value ? hashValue(*value) : 0;
+}
+
+// Vectors of plain numbers are hashed and compared as one block of bytes
+template<typename Type>
+using IsBulkElement = std::integral_constant<bool, std::is_arithmetic<Type>::value && !std::is_same<Type, bool>::value>;
+
+template<typename Type>
+uint64_t hashElements(const std::vector<Type> &value, uint64_t hash, std::true_type)
+{
+   return hashBytes(value.data(), value.size() * sizeof(Type), hash);
+}
+
+template<typename Type>
+uint64_t hashElements(const std::vector<Type> &value, uint64_t hash, std::false_type)
+{
+   for (auto i = 0u; i < value.size(); ++i) {
+      hash = hashCombine(hash, hashValue(static_cast<const Type &>(value[i])));
+   }
+
+   return hash;
+}
+
+template<typename Type>
+uint64_t hashValue(const std::vector<Type> &value)
+{
+   return hashElements(value, detail::mix(value.size()), IsBulkElement<Type> {});
+}
+
+// Entries are combined with a commutative sum, the iteration order of a map
+// depends on its insertion history.
+template<typename Key, typename Value, typename Hash>
+uint64_t hashValue(const FlatMap<Key, Value, Hash> &value)
+{
+   auto hash = detail::mix(value.size());
+
+   for (auto &entry : value) {
+      hash += hashCombine(hashValue(entry.first), hashValue(entry.second));
+   }
+
+   return hash;
+}
+
+template<typename... Types, size_t... Indices>
+uint64_t hashOneof(const Oneof<Types...> &value, std::index_sequence<Indices...>)
+{
+   auto hash = detail::mix(value.which());
+   (void)std::initializer_list<int> {
+      (value.which() == Indices + 1 ? (hash = hashCombine(hash, hashValue(value.template get<Indices + 1>())), 0) : 0)...
+   };
+   return hash;
+}
+
+template<typename... Types>
+uint64_t hashValue(const Oneof<Types...> &value)
+{
+   return hashOneof(value, std::index_sequence_for<Types...> {});
+}
+
+// Views are hashed and compared by their wire bytes
+template<typename Type>
+uint64_t hashValue(const PackedView<Type> &value)
+{
+   auto bytes = value.bytes();
+   return hashBytes(bytes.data(), bytes.size(), detail::mix(value.size()));
+}
+
+template<typename Type>
+typename std::enable_if<std::is_arithmetic<Type>::value || std::is_enum<Type>::value, bool>::type
+equalValue(const Type &lhs, const Type &rhs)
+{
+   return std::memcmp(&lhs, &rhs, sizeof(Type)) == 0;
+}
+
+inline bool equalValue(const std::string_view &lhs, const std::string_view &rhs)
+{
+   return lhs.size() == rhs.size() && (lhs.empty() || std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0);
+}
+
+template<typename Type>
+auto equalValue(const Type &lhs, const Type &rhs) -> decltype(lhs.hash(), true)
+{
+   return lhs == rhs;
+}
+
+template<typename Type>
+bool equalValue(const std::unique_ptr<Type> &lhs, const std::unique_ptr<Type> &rhs)
+{
+   if (!lhs || !rhs) {
+      return !lhs && !rhs;
+   }
+
+   return equalValue(*lhs, *rhs);
+}
+
+template<typename Type>
+bool equalElements(const std::vector<Type> &lhs, const std::vector<Type> &rhs, std::true_type)
+{
+   return lhs.empty() || std::memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(Type)) == 0;
+}
+
+template<typename Type>
+bool equalElements(const std::vector<Type> &lhs, const std::vector<Type> &rhs, std::false_type)
+{
+   for (auto i = 0u; i < lhs.size(); ++i) {
+      if (!equalValue(static_cast<const Type &>(lhs[i]), static_cast<const Type &>(rhs[i]))) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+template<typename Type>
+bool equalValue(const std::vector<Type> &lhs, const std::vector<Type> &rhs)
+{
+   return lhs.size() == rhs.size() && equalElements(lhs, rhs, IsBulkElement<Type> {});
+}
+
+template<typename Key, typename Value, typename Hash>
+bool equalValue(const FlatMap<Key, Value, Hash> &lhs, const FlatMap<Key, Value, Hash> &rhs)
+{
+   if (lhs.size() != rhs.size()) {
+      return false;
+   }
+
+   for (auto &entry : lhs) {
+      auto other = rhs.find(entry.first);
+
+      if (other == rhs.end() || !equalValue(entry.second, other->second)) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+template<typename... Types, size_t... Indices>
+bool equalOneof(const Oneof<Types...> &lhs, const Oneof<Types...> &rhs, std::index_sequence<Indices...>)
+{
+   auto equal = true;
+   (void)std::initializer_list<int> {
+      (lhs.which() == Indices + 1 ? (equal = equalValue(lhs.template get<Indices + 1>(), rhs.template get<Indices + 1>()), 0) : 0)...
+   };
+   return equal;
+}
+
+template<typename... Types>
+bool equalValue(const Oneof<Types...> &lhs, const Oneof<Types...> &rhs)
+{
+   return lhs.which() == rhs.which() && equalOneof(lhs, rhs, std::index_sequence_for<Types...> {});
+}
+
+template<typename Type>
+bool equalValue(const PackedView<Type> &lhs, const PackedView<Type> &rhs)
+{
+   return equalValue(lhs.bytes(), rhs.bytes());
+}
+
+// Lets decoded messages be used as keys of standard hashed containers
+struct MessageHash
+{
+   template<typename Type>
+   size_t operator()(const Type &value) const
+   {
+      return static_cast<size_t>(value.hash());
+   }
+};
+
+}
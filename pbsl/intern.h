@@ -0,0 +1,286 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdint.h>
+#include <vector>
+#include <string_view.h>
+#include <pbsl/hash.h>
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define PBSL_THREAD_LOCAL __declspec(thread)
+#else
+#define PBSL_THREAD_LOCAL thread_local
+#endif
+
+namespace pbsl
+{
+
+// Canonical copy of an interned string, owned by its InternTable
+struct InternEntry
+{
+   const char *text;
+   uint32_t size;
+   uint32_t id;
+   uint64_t hash;
+};
+
+// Handle to an interned string, a single pointer. Strings interned in the
+// same table are equal exactly when their handles are, so comparing them
+// never touches the text.
+class InternedString
+{
+public:
+   InternedString() :
+      mEntry(&emptyEntry())
+   {
+   }
+
+   explicit InternedString(const InternEntry *entry) :
+      mEntry(entry)
+   {
+   }
+
+   operator std::string_view() const
+   {
+      return view();
+   }
+
+   std::string_view view() const
+   {
+      return { mEntry->text, mEntry->size };
+   }
+
+   const char *data() const
+   {
+      return mEntry->text;
+   }
+
+   size_t size() const
+   {
+      return mEntry->size;
+   }
+
+   bool empty() const
+   {
+      return mEntry->size == 0;
+   }
+
+   // Dense number of the string within its table, 0 for the empty string
+   uint32_t id() const
+   {
+      return mEntry->id;
+   }
+
+   uint64_t hash() const
+   {
+      return mEntry->hash;
+   }
+
+   bool operator==(const InternedString &other) const
+   {
+      return mEntry == other.mEntry;
+   }
+
+   bool operator!=(const InternedString &other) const
+   {
+      return mEntry != other.mEntry;
+   }
+
+   // Shared by all tables so default constructed strings compare equal
+   static const InternEntry &emptyEntry()
+   {
+      static const InternEntry entry = { "", 0, 0, 0 };
+      return entry;
+   }
+
+private:
+   const InternEntry *mEntry;
+};
+
+// Thread safe set of strings. Lookups hash the string once with hashBytes,
+// which picks its shard and its slot in the shard's open addressing table,
+// and only compare the text of entries with the same 64 bit hash. Shards
+// are locked independently so concurrent parsers rarely wait on each other.
+// The hash and the text compare are the scalar hashBytes and memcmp, there is
+// no SIMD variant of either.
+//
+// Interned strings live as long as the table, a table never evicts. Bound
+// the memory of long running programs by interning into tables of their own
+// with InternScope and dropping them with the messages that use them.
+class InternTable
+{
+public:
+   static const auto ShardBits = 6u;
+   static const auto ShardCount = 1u << ShardBits;
+
+   InternTable() :
+      mNextId(1)
+   {
+   }
+
+   InternTable(const InternTable &) = delete;
+   InternTable &operator=(const InternTable &) = delete;
+
+   InternedString intern(const std::string_view &value)
+   {
+      if (value.size() == 0) {
+         return InternedString { };
+      }
+
+      auto hash = hashBytes(value.data(), value.size());
+      auto &shard = mShards[hash >> (64 - ShardBits)];
+      std::lock_guard<std::mutex> lock { shard.mutex };
+
+      if (auto entry = shard.find(hash, value)) {
+         return InternedString { entry };
+      }
+
+      return InternedString { shard.insert(hash, value, mNextId++) };
+   }
+
+   // Number of distinct non empty strings
+   size_t size() const
+   {
+      return mNextId - 1;
+   }
+
+private:
+   struct alignas(64) Shard
+   {
+      std::mutex mutex;
+      std::vector<const InternEntry *> slots;
+      size_t count = 0;
+      std::vector<std::unique_ptr<char[]>> blocks;
+      size_t blockUsed = 0;
+      size_t blockSize = 0;
+
+      const InternEntry *find(uint64_t hash, const std::string_view &value) const
+      {
+         if (slots.empty()) {
+            return nullptr;
+         }
+
+         auto mask = slots.size() - 1;
+
+         for (auto index = hash & mask; slots[index]; index = (index + 1) & mask) {
+            auto entry = slots[index];
+
+            if (entry->hash == hash && entry->size == value.size() && std::memcmp(entry->text, value.data(), value.size()) == 0) {
+               return entry;
+            }
+         }
+
+         return nullptr;
+      }
+
+      const InternEntry *insert(uint64_t hash, const std::string_view &value, uint32_t id)
+      {
+         // Keep at most half of the slots used so probe sequences stay short
+         if ((count + 1) * 2 > slots.size()) {
+            grow();
+         }
+
+         auto memory = static_cast<char *>(allocate(sizeof(InternEntry) + value.size()));
+         auto text = memory + sizeof(InternEntry);
+         std::memcpy(text, value.data(), value.size());
+         auto entry = new (memory) InternEntry { text, static_cast<uint32_t>(value.size()), id, hash };
+
+         place(entry);
+         count++;
+         return entry;
+      }
+
+      void place(const InternEntry *entry)
+      {
+         auto mask = slots.size() - 1;
+         auto index = entry->hash & mask;
+
+         while (slots[index]) {
+            index = (index + 1) & mask;
+         }
+
+         slots[index] = entry;
+      }
+
+      void grow()
+      {
+         auto old = std::move(slots);
+         slots.assign(old.empty() ? 16 : old.size() * 2, nullptr);
+
+         for (auto entry : old) {
+            if (entry) {
+               place(entry);
+            }
+         }
+      }
+
+      // Entries never move, they are carved out of blocks that double in size
+      void *allocate(size_t size)
+      {
+         size = (size + alignof(InternEntry) - 1) & ~(alignof(InternEntry) - 1);
+
+         if (blockUsed + size > blockSize) {
+            blockSize = std::max(std::max(blockSize * 2, size_t { 4096 }), size);
+            blocks.emplace_back(new char[blockSize]);
+            blockUsed = 0;
+         }
+
+         auto data = blocks.back().get() + blockUsed;
+         blockUsed += size;
+         return data;
+      }
+   };
+
+   Shard mShards[ShardCount];
+   std::atomic<uint32_t> mNextId;
+};
+
+// Process wide table, used when no InternScope is active on the thread
+inline InternTable &defaultInternTable()
+{
+   static InternTable table;
+   return table;
+}
+
+inline InternTable *&scopedInternTable()
+{
+   static PBSL_THREAD_LOCAL InternTable *table = nullptr;
+   return table;
+}
+
+// Makes the parsers on the current thread intern into table until the scope
+// ends, scopes nest. Handles from table compare unequal to handles of the
+// same text from other tables.
+class InternScope
+{
+public:
+   explicit InternScope(InternTable &table) :
+      mPrevious(scopedInternTable())
+   {
+      scopedInternTable() = &table;
+   }
+
+   ~InternScope()
+   {
+      scopedInternTable() = mPrevious;
+   }
+
+   InternScope(const InternScope &) = delete;
+   InternScope &operator=(const InternScope &) = delete;
+
+private:
+   InternTable *mPrevious;
+};
+
+// Used by generated parsers for fields with "intern = true"
+inline InternedString intern(const std::string_view &value)
+{
+   auto table = scopedInternTable();
+   return table ? table->intern(value) : defaultInternTable().intern(value);
+}
+
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <new>
+#include <stdint.h>
+#include <tuple>
+#include <utility>
+
+namespace pbsl
+{
+
+// Inline tagged union for the alternatives of a oneof. Alternatives are
+// numbered from 1 in declaration order, which() == 0 means none is set.
+// The size is that of the largest alternative plus the discriminator.
+template<typename... Types>
+class Oneof
+{
+public:
+   template<unsigned Index>
+   using Alternative = typename std::tuple_element<Index - 1, std::tuple<Types...>>::type;
+
+public:
+   Oneof()
+   {
+   }
+
+   Oneof(const Oneof &other)
+   {
+      copyFrom(other);
+   }
+
+   Oneof(Oneof &&other) noexcept
+   {
+      moveFrom(other);
+   }
+
+   ~Oneof()
+   {
+      reset();
+   }
+
+   Oneof &operator=(const Oneof &other)
+   {
+      if (this != &other) {
+         reset();
+         copyFrom(other);
+      }
+
+      return *this;
+   }
+
+   Oneof &operator=(Oneof &&other) noexcept
+   {
+      if (this != &other) {
+         reset();
+         moveFrom(other);
+      }
+
+      return *this;
+   }
+
+   unsigned which() const
+   {
+      return mWhich;
+   }
+
+   bool empty() const
+   {
+      return mWhich == 0;
+   }
+
+   // Destroys the current alternative and constructs Index in place
+   template<unsigned Index, typename... Args>
+   Alternative<Index> &emplace(Args &&... args)
+   {
+      reset();
+      auto value = new (mStorage) Alternative<Index>(std::forward<Args>(args)...);
+      mWhich = Index;
+      return *value;
+   }
+
+   template<unsigned Index>
+   Alternative<Index> &get()
+   {
+      assert(mWhich == Index);
+      return *reinterpret_cast<Alternative<Index> *>(mStorage);
+   }
+
+   template<unsigned Index>
+   const Alternative<Index> &get() const
+   {
+      assert(mWhich == Index);
+      return *reinterpret_cast<const Alternative<Index> *>(mStorage);
+   }
+
+   template<unsigned Index>
+   Alternative<Index> *getIf()
+   {
+      return mWhich == Index ? &get<Index>() : nullptr;
+   }
+
+   template<unsigned Index>
+   const Alternative<Index> *getIf() const
+   {
+      return mWhich == Index ? &get<Index>() : nullptr;
+   }
+
+   void reset()
+   {
+      static void (*const destroyers[])(void *) = { &destroy<Types>... };
+
+      if (mWhich) {
+         destroyers[mWhich - 1](mStorage);
+         mWhich = 0;
+      }
+   }
+
+private:
+   template<typename Type>
+   static void destroy(void *storage)
+   {
+      static_cast<Type *>(storage)->~Type();
+   }
+
+   template<typename Type>
+   static void copy(void *storage, const void *other)
+   {
+      new (storage) Type(*static_cast<const Type *>(other));
+   }
+
+   template<typename Type>
+   static void move(void *storage, void *other)
+   {
+      new (storage) Type(std::move(*static_cast<Type *>(other)));
+   }
+
+   void copyFrom(const Oneof &other)
+   {
+      static void (*const copiers[])(void *, const void *) = { &copy<Types>... };
+
+      if (other.mWhich) {
+         copiers[other.mWhich - 1](mStorage, other.mStorage);
+         mWhich = other.mWhich;
+      }
+   }
+
+   void moveFrom(Oneof &other)
+   {
+      static void (*const movers[])(void *, void *) = { &move<Types>... };
+
+      if (other.mWhich) {
+         movers[other.mWhich - 1](mStorage, other.mStorage);
+         mWhich = other.mWhich;
+         other.reset();
+      }
+   }
+
+private:
+   alignas(Types...) unsigned char mStorage[std::max({ sizeof(Types)... })];
+   uint32_t mWhich = 0;
+};
+
+}
@@ -0,0 +1,187 @@
+#pragma once
+#include <cassert>
+#include <cstring>
+#include <iterator>
+#include <stdint.h>
+#include <string_view.h>
+
+namespace pbsl
+{
+
+// Read only view of a packed repeated fixed width field, pointing straight
+// into the decoded input instead of copying it into a vector. The bytes may
+// be unaligned so elements are read with memcpy, which compiles to a plain
+// load. Elements are stored little endian on the wire and swapped on access
+// on big endian hosts.
+//
+// Like every field, a view is merged into by parse(). It can only hold one
+// payload, so parsing into a message whose view is already set fails. Reset
+// the message, as in message = Type {}, before reusing it for another parse.
+template<typename Type>
+class PackedView
+{
+public:
+   using value_type = Type;
+
+   class Iterator
+   {
+   public:
+      using iterator_category = std::random_access_iterator_tag;
+      using value_type = Type;
+      using difference_type = ptrdiff_t;
+      using pointer = const Type *;
+      using reference = Type;
+
+      Iterator(const char *position) :
+         mPosition(position)
+      {
+      }
+
+      Type operator*() const
+      {
+         return load(mPosition);
+      }
+
+      Type operator[](difference_type index) const
+      {
+         return load(mPosition + index * sizeof(Type));
+      }
+
+      Iterator &operator++()
+      {
+         mPosition += sizeof(Type);
+         return *this;
+      }
+
+      Iterator operator++(int)
+      {
+         auto previous = *this;
+         mPosition += sizeof(Type);
+         return previous;
+      }
+
+      Iterator &operator--()
+      {
+         mPosition -= sizeof(Type);
+         return *this;
+      }
+
+      Iterator &operator+=(difference_type count)
+      {
+         mPosition += count * static_cast<difference_type>(sizeof(Type));
+         return *this;
+      }
+
+      Iterator operator+(difference_type count) const
+      {
+         return Iterator { mPosition + count * static_cast<difference_type>(sizeof(Type)) };
+      }
+
+      difference_type operator-(const Iterator &other) const
+      {
+         return (mPosition - other.mPosition) / static_cast<difference_type>(sizeof(Type));
+      }
+
+      bool operator==(const Iterator &other) const
+      {
+         return mPosition == other.mPosition;
+      }
+
+      bool operator!=(const Iterator &other) const
+      {
+         return mPosition != other.mPosition;
+      }
+
+      bool operator<(const Iterator &other) const
+      {
+         return mPosition < other.mPosition;
+      }
+
+   private:
+      const char *mPosition;
+   };
+
+   using iterator = Iterator;
+   using const_iterator = Iterator;
+
+   PackedView() :
+      mData(nullptr),
+      mSize(0)
+   {
+   }
+
+   // Views the payload of a packed field, fails when it does not hold a
+   // whole number of elements
+   bool assign(const std::string_view &bytes)
+   {
+      if (bytes.size() % sizeof(Type) != 0) {
+         return false;
+      }
+
+      mData = bytes.data();
+      mSize = bytes.size() / sizeof(Type);
+      return true;
+   }
+
+   void clear()
+   {
+      mData = nullptr;
+      mSize = 0;
+   }
+
+   size_t size() const
+   {
+      return mSize;
+   }
+
+   bool empty() const
+   {
+      return mSize == 0;
+   }
+
+   Type operator[](size_t index) const
+   {
+      assert(index < mSize);
+      return load(mData + index * sizeof(Type));
+   }
+
+   Iterator begin() const
+   {
+      return Iterator { mData };
+   }
+
+   Iterator end() const
+   {
+      return Iterator { mData + mSize * sizeof(Type) };
+   }
+
+   // The elements as they are encoded on the wire
+   std::string_view bytes() const
+   {
+      return { mData, mSize * sizeof(Type) };
+   }
+
+private:
+   static Type load(const char *position)
+   {
+      Type value;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      char swapped[sizeof(Type)];
+
+      for (auto i = 0u; i < sizeof(Type); ++i) {
+         swapped[i] = position[sizeof(Type) - 1 - i];
+      }
+
+      std::memcpy(&value, swapped, sizeof(Type));
+#else
+      std::memcpy(&value, position, sizeof(Type));
+#endif
+      return value;
+   }
+
+private:
+   const char *mData;
+   size_t mSize;
+};
+
+}
@@ -1,10 +1,65 @@
 #pragma once
 #include <cassert>
+#include <cstring>
+#include <stdint.h>
 #include <string_view.h>
 
+// Library feature macros are only sure to be defined once <version> or the
+// header of the feature is included
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+
+#if defined(__cpp_lib_bit_cast)
+#include <bit>
+#endif
+
+// Parser and generated constexpr_parse messages can be used in constant
+// expressions from C++14, decoding floats in them needs a constexpr bit cast.
+#if (defined(__cpp_constexpr) && __cpp_constexpr >= 201304) || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402)
+#define PBSL_CONSTEXPR constexpr
+#else
+#define PBSL_CONSTEXPR inline
+#endif
+
+// Branch hints and attributes used by code generated from a field profile
+#if defined(__GNUC__) || defined(__clang__)
+#define PBSL_LIKELY(x) __builtin_expect(!!(x), 1)
+#define PBSL_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define PBSL_COLD __attribute__((cold))
+#define PBSL_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define PBSL_LIKELY(x) (x)
+#define PBSL_UNLIKELY(x) (x)
+#define PBSL_COLD
+#define PBSL_NOINLINE __declspec(noinline)
+#else
+#define PBSL_LIKELY(x) (x)
+#define PBSL_UNLIKELY(x) (x)
+#define PBSL_COLD
+#define PBSL_NOINLINE
+#endif
+
 namespace pbsl
 {
 
+template<typename To, typename From>
+PBSL_CONSTEXPR To bitCast(const From &from)
+{
+   static_assert(sizeof(To) == sizeof(From), "bitCast requires types of the same size");
+#if defined(__cpp_lib_bit_cast)
+   return std::bit_cast<To>(from);
+#elif defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 11) || (defined(_MSC_VER) && _MSC_VER >= 1927)
+   return __builtin_bit_cast(To, from);
+#else
+   auto to = To {};
+   std::memcpy(&to, &from, sizeof(To));
+   return to;
+#endif
+}
+
 class Parser
 {
 public:
@@ -28,179 +83,250 @@ public:
    };
 
 public:
-   Parser(const std::string_view &data) :
-      mData(reinterpret_cast<ptrdiff_t>(data.data())),
+   PBSL_CONSTEXPR Parser(const std::string_view &data) :
+      mData(data.data()),
       mSize(data.size()),
       mPosition(0)
    {
    }
 
-   bool eof()
+   PBSL_CONSTEXPR bool eof() const
    {
       return mPosition == mSize;
    }
 
-   Tag readTag()
+   PBSL_CONSTEXPR size_t position() const
+   {
+      return mPosition;
+   }
+
+   PBSL_CONSTEXPR Tag readTag()
    {
-      unsigned field = *reinterpret_cast<uint16_t*>(mData + mPosition);
-      unsigned type = field & TagTypeMask;
+      auto low = byteAt(0);
+      auto high = mPosition + 1 < mSize ? byteAt(1) : 0u;
+      unsigned type = low & TagTypeMask;
 
       // ffff is just padding, set EOF, return 0
-      if (field == 0xffff) {
+      if (low == 0xff && high == 0xff) {
          mPosition = mSize;
          return { 0, 0 };
       }
-      
-      if (field & 0x80) {
-         field = ((field & 0x7f) | ((field & 0xff00) >> 1)) >> TagTypeBits;
-         mPosition += 2;
-      } else {
-         field = (field & 0xff) >> TagTypeBits;
-         mPosition += 1;
+
+      if (low & 0x80) {
+         return { readVarUint32() >> TagTypeBits, type };
       }
 
-      return { field, type };
+      mPosition += 1;
+      return { low >> TagTypeBits, type };
    }
 
-   float readFloat()
+   PBSL_CONSTEXPR float readFloat()
    {
-      auto value = *reinterpret_cast<float*>(mData + mPosition);
-      mPosition += 4;
-      return value;
+      return bitCast<float>(readFixed32());
    }
 
-   double readDouble()
+   PBSL_CONSTEXPR double readDouble()
    {
-      auto value = *reinterpret_cast<double*>(mData + mPosition);
-      mPosition += 8;
-      return value;
+      return bitCast<double>(readFixed64());
    }
 
-   int32_t readInt32()
+   PBSL_CONSTEXPR int32_t readInt32()
    {
       return static_cast<int32_t>(readVarUint32());
    }
 
-   int64_t readInt64()
+   PBSL_CONSTEXPR int64_t readInt64()
    {
       return static_cast<int64_t>(readVarUint64());
    }
 
-   uint32_t readUint32()
+   PBSL_CONSTEXPR uint32_t readUint32()
    {
       return readVarUint32();
    }
 
-   uint64_t readUint64()
+   PBSL_CONSTEXPR uint64_t readUint64()
    {
       return readVarUint64();
    }
 
-   int32_t readSint32()
+   PBSL_CONSTEXPR int32_t readSint32()
    {
       return zigZagDecode32(readVarUint32());
    }
 
-   int64_t readSint64()
+   PBSL_CONSTEXPR int64_t readSint64()
    {
       return zigZagDecode64(readVarUint64());
    }
 
-   uint32_t readFixed32()
+   PBSL_CONSTEXPR uint32_t readFixed32()
    {
-      auto value = *reinterpret_cast<uint32_t*>(mData + mPosition);
-      mPosition += 4;
-      return value;
+      return readLittleEndian<uint32_t>();
    }
 
-   uint64_t readFixed64()
+   PBSL_CONSTEXPR uint64_t readFixed64()
    {
-      auto value = *reinterpret_cast<uint64_t*>(mData + mPosition);
-      mPosition += 8;
-      return value;
+      return readLittleEndian<uint64_t>();
    }
 
-   int32_t readSfixed32()
+   PBSL_CONSTEXPR int32_t readSfixed32()
    {
-      auto value = *reinterpret_cast<int32_t*>(mData + mPosition);
-      mPosition += 4;
-      return value;
+      return static_cast<int32_t>(readLittleEndian<uint32_t>());
    }
 
-   int64_t readSfixed64()
+   PBSL_CONSTEXPR int64_t readSfixed64()
    {
-      auto value = *reinterpret_cast<int64_t*>(mData + mPosition);
-      mPosition += 8;
-      return value;
+      return static_cast<int64_t>(readLittleEndian<uint64_t>());
    }
 
-   bool readBool()
+   PBSL_CONSTEXPR bool readBool()
    {
       return !!readVarUint32();
    }
 
-   std::string_view readString()
+   PBSL_CONSTEXPR std::string_view readString()
    {
       auto length = readVarUint32();
-      auto value = std::string_view { reinterpret_cast<std::string_view::char_type*>(mData + mPosition), length };
+      auto value = std::string_view { mData + mPosition, length };
       mPosition += length;
       return value;
    }
 
-   std::string_view readBytes()
+   PBSL_CONSTEXPR std::string_view readBytes()
    {
       return readString();
    }
 
-   std::string_view readMessage()
+   PBSL_CONSTEXPR std::string_view readMessage()
    {
       return readString();
    }
 
-   uint32_t readVarUint32()
+   PBSL_CONSTEXPR void skipVarInt()
+   {
+      auto bytes = 1u;
+
+      while (byteAt(bytes - 1) & 0x80 && bytes < 10) {
+         bytes++;
+      }
+
+      mPosition += bytes;
+   }
+
+   // Skips the value of a field using only its wire type
+   PBSL_CONSTEXPR void skipField(unsigned type)
+   {
+      if (eof()) {
+         return;
+      }
+
+      switch (type) {
+      case WireType::VarInt:
+         skipVarInt();
+         break;
+      case WireType::Fixed64:
+         mPosition += 8;
+         break;
+      case WireType::LengthDelimited:
+         mPosition += readVarUint32();
+         break;
+      case WireType::Fixed32:
+         mPosition += 4;
+         break;
+      default:
+         assert(0 && "Unsupported wire type!");
+         mPosition = mSize;
+      }
+   }
+
+   PBSL_CONSTEXPR uint32_t readVarUint32()
    {
-      auto ptr = reinterpret_cast<const uint8_t*>(mData + mPosition);
       auto value = 0u;
       auto bytes = 0u;
+      auto more = true;
 
+      // Negative int32 values are sign extended to 10 bytes, keep the low 32 bits
       do {
-         value |= (*ptr & 0x7f) << (bytes * 7u);
+         auto byte = byteAt(bytes);
+
+         if (bytes < 5) {
+            value |= (byte & 0x7fu) << (bytes * 7u);
+         }
+
+         more = (byte & 0x80) != 0;
          bytes++;
-      } while (*(ptr++) & 0x80 && bytes <= 5);
+      } while (more && bytes < 10);
 
       mPosition += bytes;
       return value;
    }
 
-   uint64_t readVarUint64()
+   PBSL_CONSTEXPR uint64_t readVarUint64()
    {
-      auto ptr = reinterpret_cast<const uint8_t*>(mData + mPosition);
       auto value = 0ull;
       auto bytes = 0u;
+      auto more = true;
 
       do {
-         value |= (*ptr & 0x7f) << (bytes * 7u);
+         auto byte = byteAt(bytes);
+         value |= static_cast<uint64_t>(byte & 0x7f) << (bytes * 7u);
+         more = (byte & 0x80) != 0;
          bytes++;
-      } while (*(ptr++) & 0x80 && bytes <= 10);
+      } while (more && bytes < 10);
 
       mPosition += bytes;
       return value;
    }
 
-   uint32_t zigZagDecode32(uint32_t value)
+   static PBSL_CONSTEXPR uint32_t zigZagDecode32(uint32_t value)
    {
-      return (value >> 1) ^ -static_cast<int32_t>(value & 1);
+      return (value >> 1) ^ static_cast<uint32_t>(-static_cast<int32_t>(value & 1));
    }
 
-   uint64_t zigZagDecode64(uint64_t value)
+   static PBSL_CONSTEXPR uint64_t zigZagDecode64(uint64_t value)
    {
-      return (value >> 1) ^ -static_cast<int64_t>(value & 1);
+      return (value >> 1) ^ static_cast<uint64_t>(-static_cast<int64_t>(value & 1));
    }
 
 private:
-   ptrdiff_t mData;
+   PBSL_CONSTEXPR unsigned byteAt(size_t offset) const
+   {
+      return static_cast<uint8_t>(mData[mPosition + offset]);
+   }
+
+   // Assembled a byte at a time so it stays valid in constant expressions
+   // and for unaligned data, compilers fold it into a single load.
+   template<typename Type>
+   PBSL_CONSTEXPR Type readLittleEndian()
+   {
+      auto value = Type { 0 };
+
+      for (auto i = 0u; i < sizeof(Type); ++i) {
+         value |= static_cast<Type>(byteAt(i)) << (i * 8u);
+      }
+
+      mPosition += sizeof(Type);
+      return value;
+   }
+
+private:
+   const std::string_view::char_type *mData;
    size_t mSize;
    size_t mPosition;
 };
 
+// Decodes a message in a constant expression, for messages generated with
+// option constexpr_parse = true:
+//    constexpr auto config = pbsl::parseConstant<Config>(std::string_view { blob, sizeof(blob) - 1 });
+template<typename Type>
+PBSL_CONSTEXPR Type parseConstant(const std::string_view &data)
+{
+   auto value = Type {};
+   auto parsed = value.parse(data);
+   assert(parsed && "Invalid constant message!");
+   (void)parsed;
+   return value;
+}
+
 }
\ No newline at end of file
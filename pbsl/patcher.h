@@ -0,0 +1,334 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <stdint.h>
+#include <string>
+#include <string_view.h>
+#include <pbsl/parser.h>
+#include <pbsl/writer.h>
+
+namespace pbsl
+{
+
+// Rewrites single fields of an encoded message without decoding it.
+//
+// A field is addressed by a path of field numbers, every number but the last
+// names a sub message to descend into. The occurrence patched is the one a
+// parse() reads, the last one across all occurrences of the enclosing
+// messages. Fixed width values are overwritten in place, varints and length
+// delimited values are spliced in and the lengths of all enclosing messages
+// are fixed up. A missing leaf field is appended to the last occurrence of
+// its enclosing message.
+class Patcher
+{
+public:
+   static const auto MaxDepth = 32u;
+
+   Patcher(std::string &buffer) :
+      mBuffer(buffer)
+   {
+   }
+
+   bool setFixed32(const std::initializer_list<unsigned> &path, uint32_t value)
+   {
+      auto location = Location {};
+
+      if (!locate(path, Parser::WireType::Fixed32, location)) {
+         return false;
+      }
+
+      auto encoded = std::string {};
+      Writer { encoded }.writeFixed32(value);
+      return replace(location, encoded);
+   }
+
+   bool setFixed64(const std::initializer_list<unsigned> &path, uint64_t value)
+   {
+      auto location = Location {};
+
+      if (!locate(path, Parser::WireType::Fixed64, location)) {
+         return false;
+      }
+
+      auto encoded = std::string {};
+      Writer { encoded }.writeFixed64(value);
+      return replace(location, encoded);
+   }
+
+   bool setSfixed32(const std::initializer_list<unsigned> &path, int32_t value)
+   {
+      return setFixed32(path, static_cast<uint32_t>(value));
+   }
+
+   bool setSfixed64(const std::initializer_list<unsigned> &path, int64_t value)
+   {
+      return setFixed64(path, static_cast<uint64_t>(value));
+   }
+
+   bool setFloat(const std::initializer_list<unsigned> &path, float value)
+   {
+      uint32_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      return setFixed32(path, bits);
+   }
+
+   bool setDouble(const std::initializer_list<unsigned> &path, double value)
+   {
+      uint64_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      return setFixed64(path, bits);
+   }
+
+   bool setVarUint(const std::initializer_list<unsigned> &path, uint64_t value)
+   {
+      auto location = Location {};
+
+      if (!locate(path, Parser::WireType::VarInt, location)) {
+         return false;
+      }
+
+      auto encoded = std::string {};
+      Writer { encoded }.writeVarUint64(value);
+      return replace(location, encoded);
+   }
+
+   bool setInt32(const std::initializer_list<unsigned> &path, int32_t value)
+   {
+      return setVarUint(path, static_cast<uint64_t>(static_cast<int64_t>(value)));
+   }
+
+   bool setInt64(const std::initializer_list<unsigned> &path, int64_t value)
+   {
+      return setVarUint(path, static_cast<uint64_t>(value));
+   }
+
+   bool setUint32(const std::initializer_list<unsigned> &path, uint32_t value)
+   {
+      return setVarUint(path, value);
+   }
+
+   bool setUint64(const std::initializer_list<unsigned> &path, uint64_t value)
+   {
+      return setVarUint(path, value);
+   }
+
+   bool setSint32(const std::initializer_list<unsigned> &path, int32_t value)
+   {
+      return setVarUint(path, Writer::zigZagEncode32(value));
+   }
+
+   bool setSint64(const std::initializer_list<unsigned> &path, int64_t value)
+   {
+      return setVarUint(path, Writer::zigZagEncode64(value));
+   }
+
+   bool setBool(const std::initializer_list<unsigned> &path, bool value)
+   {
+      return setVarUint(path, value ? 1 : 0);
+   }
+
+   bool setString(const std::initializer_list<unsigned> &path, const std::string_view &value)
+   {
+      auto location = Location {};
+
+      if (!locate(path, Parser::WireType::LengthDelimited, location)) {
+         return false;
+      }
+
+      auto encoded = std::string {};
+      Writer { encoded }.writeString(value);
+      return replace(location, encoded);
+   }
+
+   bool setBytes(const std::initializer_list<unsigned> &path, const std::string_view &value)
+   {
+      return setString(path, value);
+   }
+
+   // Replaces a whole sub message with an already encoded one
+   bool setMessage(const std::initializer_list<unsigned> &path, const std::string_view &value)
+   {
+      return setString(path, value);
+   }
+
+private:
+   struct Location
+   {
+      // Offsets of the length prefixes of the enclosing messages, outermost first
+      size_t enclosing[MaxDepth];
+      unsigned depth;
+
+      // Value bytes to replace, for length delimited values including the length
+      size_t start;
+      size_t end;
+
+      // Set when the field was not found and has to be appended with its tag
+      bool insert;
+      unsigned field;
+      unsigned type;
+   };
+
+   // Best location found so far, a field found anywhere wins over appending
+   // it to an enclosing message
+   enum class Match
+   {
+      None,
+      Message,
+      Field
+   };
+
+   bool locate(const std::initializer_list<unsigned> &path, unsigned type, Location &location)
+   {
+      if (path.size() == 0 || path.size() > MaxDepth) {
+         return false;
+      }
+
+      auto current = Location {};
+      auto match = Match::None;
+
+      if (!search(path.begin(), path.end(), type, 0, mBuffer.size(), current, location, match)) {
+         return false;
+      }
+
+      return match != Match::None && location.end <= mBuffer.size();
+   }
+
+   // Scans [start, end) for the field at *field. A parse() keeps the last
+   // occurrence of a field and merges every occurrence of a sub message, so
+   // all occurrences are searched and the last one found is kept in best.
+   // Fails when an occurrence has a wire type that does not fit the path,
+   // or when a tag, value or length runs past end, which Parser::eof() alone
+   // would not stop at.
+   bool search(const unsigned *field, const unsigned *last, unsigned type, size_t start, size_t end, Location &current, Location &best, Match &match)
+   {
+      auto isLeaf = (field + 1 == last);
+      auto size = end - start;
+      auto parser = Parser { std::string_view { mBuffer.data() + start, size } };
+
+      if (isLeaf && match != Match::Field) {
+         // Appended to the last occurrence of its enclosing message
+         best = current;
+         best.start = end;
+         best.end = end;
+         best.insert = true;
+         best.field = *field;
+         best.type = type;
+         match = Match::Message;
+      }
+
+      while (!parser.eof()) {
+         auto tag = parser.readTag();
+
+         if (parser.position() > size) {
+            return false;
+         }
+
+         if (tag.field == 0) {
+            break;
+         }
+
+         // Every wire type has at least one byte of value
+         if (parser.eof()) {
+            return false;
+         }
+
+         if (tag.field != *field) {
+            parser.skipField(tag.type);
+
+            if (parser.position() > size) {
+               return false;
+            }
+
+            continue;
+         }
+
+         if (isLeaf) {
+            if (tag.type != type) {
+               return false;
+            }
+
+            auto valueStart = parser.position();
+            parser.skipField(tag.type);
+
+            if (parser.position() > size) {
+               return false;
+            }
+
+            best = current;
+            best.start = start + valueStart;
+            best.end = start + parser.position();
+            best.insert = false;
+            match = Match::Field;
+            continue;
+         }
+
+         if (tag.type != Parser::WireType::LengthDelimited) {
+            return false;
+         }
+
+         current.enclosing[current.depth++] = start + parser.position();
+         auto message = parser.readMessage();
+
+         if (parser.position() > size) {
+            return false;
+         }
+
+         auto messageStart = start + parser.position() - message.size();
+
+         if (!search(field + 1, last, type, messageStart, messageStart + message.size(), current, best, match)) {
+            return false;
+         }
+
+         current.depth--;
+      }
+
+      return true;
+   }
+
+   bool replace(Location &location, const std::string &value)
+   {
+      auto oldSize = location.end - location.start;
+
+      if (!location.insert && value.size() == oldSize) {
+         std::memcpy(&mBuffer[location.start], value.data(), oldSize);
+         return true;
+      }
+
+      if (location.insert) {
+         auto encoded = std::string {};
+         auto writer = Writer { encoded };
+         writer.writeTag(location.field, location.type);
+         encoded.append(value);
+         mBuffer.insert(location.start, encoded);
+         fixLengths(location, static_cast<ptrdiff_t>(encoded.size()));
+         return true;
+      }
+
+      mBuffer.replace(location.start, oldSize, value);
+      fixLengths(location, static_cast<ptrdiff_t>(value.size()) - static_cast<ptrdiff_t>(oldSize));
+      return true;
+   }
+
+   // Innermost first, the length prefixes all precede the spliced bytes so
+   // their offsets stay valid, a prefix changing size only grows the delta.
+   void fixLengths(Location &location, ptrdiff_t delta)
+   {
+      for (auto i = location.depth; i > 0 && delta != 0; --i) {
+         auto offset = location.enclosing[i - 1];
+         auto parser = Parser { std::string_view { mBuffer.data() + offset, mBuffer.size() - offset } };
+         auto length = parser.readVarUint32();
+         auto oldSize = parser.position();
+         auto encoded = std::string {};
+
+         Writer { encoded }.writeVarUint32(static_cast<uint32_t>(static_cast<ptrdiff_t>(length) + delta));
+         mBuffer.replace(offset, oldSize, encoded);
+         delta += static_cast<ptrdiff_t>(encoded.size()) - static_cast<ptrdiff_t>(oldSize);
+      }
+   }
+
+private:
+   std::string &mBuffer;
+};
+
+}
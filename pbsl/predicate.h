@@ -0,0 +1,1086 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <string_view.h>
+#include <pbsl/parser.h>
+
+namespace pbsl
+{
+
+// Filters encoded messages on a few fields without decoding them. A
+// predicate is parsed once, either from an expression:
+//
+//    auto predicate = pbsl::Predicate {};
+//    predicate.parse("3 == 42 && any(7.2) in {1, 2, 3} && !has(9)");
+//
+// or with the builder:
+//
+//    auto predicate = pbsl::Predicate { pbsl::fieldAt({ 3 }) == 42 && pbsl::fieldAt({ 7, 2 }).any().in({ 1, 2, 3 }) && !pbsl::hasField({ 9 }) };
+//
+// into a tree of nodes, which is then interpreted on the wire bytes of each
+// record. A field is addressed by a path of field numbers like for the
+// Patcher, every number but the last names a sub message. Each comparison
+// walks the record with a Parser, skipping other fields and sub messages by
+// their length. && and || stop as soon as the result is known.
+//
+// A field compares like a decoded message reads it: when it occurs more than
+// once the last occurrence wins, also across several occurrences of the sub
+// messages on its path, which parse() merges. Repeated fields are compared
+// with any(path) instead, which is true when any of their elements matches
+// and stops at the first one that does. has(path) is true when the field
+// occurs at all.
+//
+// Values are interpreted from their wire type and the literal they are
+// compared with:
+//  - varints are signed 64 bit integers, sint(path) decodes zigzag
+//  - fixed32 and fixed64 values are unsigned, or signed with sfixed(path),
+//    and float or double when compared with a real literal such as 1.5
+//  - length delimited values compare as bytes with string literals
+// A singular field that does not occur compares as its default, 0, 0.0 or "",
+// a repeated field without elements matches nothing. Packed repeated fields
+// are not looked into.
+//
+// Expression syntax:
+//    expression := and ("||" and)*
+//    and        := unary ("&&" unary)*
+//    unary      := "!" unary | "(" expression ")" | "has" "(" path ")" | operand compare
+//    operand    := field | "any" "(" field ")"
+//    field      := path | "sint" "(" path ")" | "sfixed" "(" path ")"
+//    compare    := ("==" | "!=" | "<" | "<=" | ">" | ">=") literal | "in" "{" literal ("," literal)* "}"
+//    path       := number ("." number)*
+//    literal    := integer | real | "string" | true | false
+struct PredicateLiteral
+{
+   enum class Kind
+   {
+      Integer,
+      Real,
+      String
+   };
+
+   Kind kind = Kind::Integer;
+   int64_t integer = 0;
+   double real = 0;
+   std::string string;
+
+   PredicateLiteral()
+   {
+   }
+
+   template<typename Type, typename std::enable_if<std::is_integral<Type>::value, int>::type = 0>
+   PredicateLiteral(Type value) :
+      kind(Kind::Integer),
+      integer(static_cast<int64_t>(value))
+   {
+   }
+
+   template<typename Type, typename std::enable_if<std::is_floating_point<Type>::value, int>::type = 0>
+   PredicateLiteral(Type value) :
+      kind(Kind::Real),
+      real(static_cast<double>(value))
+   {
+   }
+
+   PredicateLiteral(const std::string_view &value) :
+      kind(Kind::String),
+      string(value.data(), value.size())
+   {
+   }
+
+   PredicateLiteral(const char *value) :
+      kind(Kind::String),
+      string(value)
+   {
+   }
+};
+
+struct PredicateNode
+{
+   enum class Kind
+   {
+      And,
+      Or,
+      Not,
+      Compare,
+      In,
+      Has
+   };
+
+   enum class Operator
+   {
+      Equal,
+      NotEqual,
+      Less,
+      LessEqual,
+      Greater,
+      GreaterEqual
+   };
+
+   enum class Cast
+   {
+      None,
+      Sint,
+      Sfixed
+   };
+
+   Kind kind = Kind::Has;
+
+   // Children of And, Or and Not, which always come before their parent
+   unsigned left = 0;
+   unsigned right = 0;
+
+   std::vector<unsigned> path;
+   Cast cast = Cast::None;
+
+   // Any element of a repeated field matches instead of the last occurrence
+   bool any = false;
+
+   Operator op = Operator::Equal;
+   std::vector<PredicateLiteral> values;
+};
+
+// An expression built in C++, its root is the last node
+class PredicateExpression
+{
+public:
+   explicit PredicateExpression(PredicateNode node)
+   {
+      mNodes.push_back(std::move(node));
+   }
+
+   const std::vector<PredicateNode> &nodes() const
+   {
+      return mNodes;
+   }
+
+   friend PredicateExpression operator&&(const PredicateExpression &left, const PredicateExpression &right)
+   {
+      return combine(PredicateNode::Kind::And, left, right);
+   }
+
+   friend PredicateExpression operator||(const PredicateExpression &left, const PredicateExpression &right)
+   {
+      return combine(PredicateNode::Kind::Or, left, right);
+   }
+
+   friend PredicateExpression operator!(const PredicateExpression &operand)
+   {
+      auto result = operand;
+      auto node = PredicateNode {};
+      node.kind = PredicateNode::Kind::Not;
+      node.left = static_cast<unsigned>(operand.mNodes.size() - 1);
+      result.mNodes.push_back(std::move(node));
+      return result;
+   }
+
+private:
+   static PredicateExpression combine(PredicateNode::Kind kind, const PredicateExpression &left, const PredicateExpression &right)
+   {
+      auto result = left;
+      auto offset = static_cast<unsigned>(left.mNodes.size());
+
+      for (auto node : right.mNodes) {
+         if (node.kind == PredicateNode::Kind::And || node.kind == PredicateNode::Kind::Or || node.kind == PredicateNode::Kind::Not) {
+            node.left += offset;
+            node.right += offset;
+         }
+
+         result.mNodes.push_back(std::move(node));
+      }
+
+      auto node = PredicateNode {};
+      node.kind = kind;
+      node.left = offset - 1;
+      node.right = static_cast<unsigned>(result.mNodes.size() - 1);
+      result.mNodes.push_back(std::move(node));
+      return result;
+   }
+
+private:
+   std::vector<PredicateNode> mNodes;
+};
+
+// Operand of a comparison in the builder, see fieldAt()
+class PredicateField
+{
+public:
+   PredicateField(const std::initializer_list<unsigned> &path) :
+      mPath(path),
+      mCast(PredicateNode::Cast::None),
+      mAny(false)
+   {
+   }
+
+   PredicateField any() const
+   {
+      auto result = *this;
+      result.mAny = true;
+      return result;
+   }
+
+   PredicateField sint() const
+   {
+      auto result = *this;
+      result.mCast = PredicateNode::Cast::Sint;
+      return result;
+   }
+
+   PredicateField sfixed() const
+   {
+      auto result = *this;
+      result.mCast = PredicateNode::Cast::Sfixed;
+      return result;
+   }
+
+   PredicateExpression operator==(const PredicateLiteral &value) const
+   {
+      return compare(PredicateNode::Operator::Equal, value);
+   }
+
+   PredicateExpression operator!=(const PredicateLiteral &value) const
+   {
+      return compare(PredicateNode::Operator::NotEqual, value);
+   }
+
+   PredicateExpression operator<(const PredicateLiteral &value) const
+   {
+      return compare(PredicateNode::Operator::Less, value);
+   }
+
+   PredicateExpression operator<=(const PredicateLiteral &value) const
+   {
+      return compare(PredicateNode::Operator::LessEqual, value);
+   }
+
+   PredicateExpression operator>(const PredicateLiteral &value) const
+   {
+      return compare(PredicateNode::Operator::Greater, value);
+   }
+
+   PredicateExpression operator>=(const PredicateLiteral &value) const
+   {
+      return compare(PredicateNode::Operator::GreaterEqual, value);
+   }
+
+   PredicateExpression in(const std::initializer_list<PredicateLiteral> &values) const
+   {
+      auto node = makeNode(PredicateNode::Kind::In);
+      node.values.assign(values.begin(), values.end());
+      return PredicateExpression { std::move(node) };
+   }
+
+   PredicateExpression has() const
+   {
+      return PredicateExpression { makeNode(PredicateNode::Kind::Has) };
+   }
+
+private:
+   PredicateNode makeNode(PredicateNode::Kind kind) const
+   {
+      auto node = PredicateNode {};
+      node.kind = kind;
+      node.path = mPath;
+      node.cast = mCast;
+      node.any = mAny;
+      return node;
+   }
+
+   PredicateExpression compare(PredicateNode::Operator op, const PredicateLiteral &value) const
+   {
+      auto node = makeNode(PredicateNode::Kind::Compare);
+      node.op = op;
+      node.values.push_back(value);
+      return PredicateExpression { std::move(node) };
+   }
+
+private:
+   std::vector<unsigned> mPath;
+   PredicateNode::Cast mCast;
+   bool mAny;
+};
+
+inline PredicateField fieldAt(const std::initializer_list<unsigned> &path)
+{
+   return PredicateField { path };
+}
+
+inline PredicateExpression hasField(const std::initializer_list<unsigned> &path)
+{
+   return PredicateField { path }.has();
+}
+
+// Recursive descent parser for the expression syntax
+class PredicateParser
+{
+public:
+   PredicateParser(const std::string_view &expression, std::vector<PredicateNode> &nodes) :
+      mText(expression),
+      mPosition(0),
+      mNodes(nodes)
+   {
+   }
+
+   bool parse()
+   {
+      if (!parseOr()) {
+         return false;
+      }
+
+      skipSpace();
+      return mPosition == mText.size();
+   }
+
+   size_t position() const
+   {
+      return mPosition;
+   }
+
+private:
+   bool parseOr()
+   {
+      if (!parseAnd()) {
+         return false;
+      }
+
+      while (accept("||")) {
+         auto left = static_cast<unsigned>(mNodes.size() - 1);
+
+         if (!parseAnd()) {
+            return false;
+         }
+
+         addBinary(PredicateNode::Kind::Or, left);
+      }
+
+      return true;
+   }
+
+   bool parseAnd()
+   {
+      if (!parseUnary()) {
+         return false;
+      }
+
+      while (accept("&&")) {
+         auto left = static_cast<unsigned>(mNodes.size() - 1);
+
+         if (!parseUnary()) {
+            return false;
+         }
+
+         addBinary(PredicateNode::Kind::And, left);
+      }
+
+      return true;
+   }
+
+   bool parseUnary()
+   {
+      if (accept("!")) {
+         if (!parseUnary()) {
+            return false;
+         }
+
+         auto node = PredicateNode {};
+         node.kind = PredicateNode::Kind::Not;
+         node.left = static_cast<unsigned>(mNodes.size() - 1);
+         mNodes.push_back(std::move(node));
+         return true;
+      }
+
+      if (accept("(")) {
+         return parseOr() && accept(")");
+      }
+
+      auto node = PredicateNode {};
+
+      if (acceptWord("has")) {
+         node.kind = PredicateNode::Kind::Has;
+
+         if (!accept("(") || !parsePath(node.path) || !accept(")")) {
+            return false;
+         }
+
+         mNodes.push_back(std::move(node));
+         return true;
+      }
+
+      if (acceptWord("any")) {
+         node.any = true;
+
+         if (!accept("(") || !parseField(node) || !accept(")")) {
+            return false;
+         }
+      } else if (!parseField(node)) {
+         return false;
+      }
+
+      if (acceptWord("in")) {
+         node.kind = PredicateNode::Kind::In;
+
+         if (!accept("{")) {
+            return false;
+         }
+
+         do {
+            node.values.emplace_back();
+
+            if (!parseLiteral(node.values.back())) {
+               return false;
+            }
+         } while (accept(","));
+
+         if (!accept("}")) {
+            return false;
+         }
+      } else {
+         node.kind = PredicateNode::Kind::Compare;
+         node.values.emplace_back();
+
+         if (!parseOperator(node.op) || !parseLiteral(node.values.back())) {
+            return false;
+         }
+      }
+
+      mNodes.push_back(std::move(node));
+      return true;
+   }
+
+   bool parseField(PredicateNode &node)
+   {
+      if (acceptWord("sint")) {
+         node.cast = PredicateNode::Cast::Sint;
+      } else if (acceptWord("sfixed")) {
+         node.cast = PredicateNode::Cast::Sfixed;
+      }
+
+      if (node.cast != PredicateNode::Cast::None) {
+         return accept("(") && parsePath(node.path) && accept(")");
+      }
+
+      return parsePath(node.path);
+   }
+
+   bool parseOperator(PredicateNode::Operator &op)
+   {
+      // Two character operators first so "<=" is not read as "<"
+      if (accept("==")) {
+         op = PredicateNode::Operator::Equal;
+      } else if (accept("!=")) {
+         op = PredicateNode::Operator::NotEqual;
+      } else if (accept("<=")) {
+         op = PredicateNode::Operator::LessEqual;
+      } else if (accept(">=")) {
+         op = PredicateNode::Operator::GreaterEqual;
+      } else if (accept("<")) {
+         op = PredicateNode::Operator::Less;
+      } else if (accept(">")) {
+         op = PredicateNode::Operator::Greater;
+      } else {
+         return false;
+      }
+
+      return true;
+   }
+
+   bool parsePath(std::vector<unsigned> &path)
+   {
+      skipSpace();
+
+      do {
+         auto start = mPosition;
+         auto number = 0u;
+
+         while (mPosition < mText.size() && isDigit(mText[mPosition])) {
+            number = number * 10 + static_cast<unsigned>(mText[mPosition++] - '0');
+         }
+
+         if (mPosition == start || number == 0) {
+            return false;
+         }
+
+         path.push_back(number);
+      } while (mPosition < mText.size() && mText[mPosition] == '.' && ++mPosition);
+
+      return true;
+   }
+
+   bool parseLiteral(PredicateLiteral &literal)
+   {
+      skipSpace();
+
+      if (acceptWord("true")) {
+         literal = PredicateLiteral { 1 };
+         return true;
+      }
+
+      if (acceptWord("false")) {
+         literal = PredicateLiteral { 0 };
+         return true;
+      }
+
+      if (mPosition < mText.size() && mText[mPosition] == '"') {
+         return parseString(literal);
+      }
+
+      auto start = mPosition;
+      auto real = false;
+
+      if (mPosition < mText.size() && (mText[mPosition] == '-' || mText[mPosition] == '+')) {
+         mPosition++;
+      }
+
+      while (mPosition < mText.size()) {
+         auto c = mText[mPosition];
+
+         if (c == '.' || c == 'e' || c == 'E' || ((c == '-' || c == '+') && (mText[mPosition - 1] == 'e' || mText[mPosition - 1] == 'E'))) {
+            real = true;
+         } else if (!isDigit(c)) {
+            break;
+         }
+
+         mPosition++;
+      }
+
+      auto text = std::string { mText.data() + start, mPosition - start };
+      char *end = nullptr;
+
+      if (real) {
+         literal = PredicateLiteral { std::strtod(text.c_str(), &end) };
+      } else {
+         literal = PredicateLiteral { static_cast<int64_t>(std::strtoll(text.c_str(), &end, 10)) };
+      }
+
+      return !text.empty() && end == text.c_str() + text.size();
+   }
+
+   bool parseString(PredicateLiteral &literal)
+   {
+      auto value = std::string {};
+      mPosition++;
+
+      while (mPosition < mText.size() && mText[mPosition] != '"') {
+         auto c = mText[mPosition++];
+
+         if (c == '\\') {
+            if (mPosition == mText.size()) {
+               return false;
+            }
+
+            c = mText[mPosition++];
+
+            if (c == 'n') {
+               c = '\n';
+            } else if (c == 't') {
+               c = '\t';
+            } else if (c == 'x') {
+               auto high = hexValue(mPosition);
+               auto low = hexValue(mPosition + 1);
+
+               if (high < 0 || low < 0) {
+                  return false;
+               }
+
+               c = static_cast<char>(high * 16 + low);
+               mPosition += 2;
+            }
+         }
+
+         value.push_back(c);
+      }
+
+      if (mPosition == mText.size()) {
+         return false;
+      }
+
+      mPosition++;
+      literal = PredicateLiteral { std::string_view { value.data(), value.size() } };
+      return true;
+   }
+
+   void addBinary(PredicateNode::Kind kind, unsigned left)
+   {
+      auto node = PredicateNode {};
+      node.kind = kind;
+      node.left = left;
+      node.right = static_cast<unsigned>(mNodes.size() - 1);
+      mNodes.push_back(std::move(node));
+   }
+
+   bool accept(const char *token)
+   {
+      skipSpace();
+      auto size = std::strlen(token);
+
+      if (mText.size() - mPosition >= size && std::memcmp(mText.data() + mPosition, token, size) == 0) {
+         mPosition += size;
+         return true;
+      }
+
+      return false;
+   }
+
+   // Keywords must not run into a following name, "index" is not "in"
+   bool acceptWord(const char *word)
+   {
+      auto start = mPosition;
+
+      if (!accept(word)) {
+         return false;
+      }
+
+      if (mPosition < mText.size() && (isDigit(mText[mPosition]) || std::isalpha(static_cast<unsigned char>(mText[mPosition])) || mText[mPosition] == '_')) {
+         mPosition = start;
+         return false;
+      }
+
+      return true;
+   }
+
+   void skipSpace()
+   {
+      while (mPosition < mText.size() && std::isspace(static_cast<unsigned char>(mText[mPosition]))) {
+         mPosition++;
+      }
+   }
+
+   int hexValue(size_t position) const
+   {
+      if (position >= mText.size()) {
+         return -1;
+      }
+
+      auto c = mText[position];
+
+      if (isDigit(c)) {
+         return c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+         return c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+         return c - 'A' + 10;
+      }
+
+      return -1;
+   }
+
+   static bool isDigit(char c)
+   {
+      return c >= '0' && c <= '9';
+   }
+
+private:
+   std::string_view mText;
+   size_t mPosition;
+   std::vector<PredicateNode> &mNodes;
+};
+
+class Predicate
+{
+public:
+   // Matches every record until parsed
+   Predicate()
+   {
+   }
+
+   Predicate(const PredicateExpression &expression) :
+      mNodes(expression.nodes())
+   {
+   }
+
+   // Fails on a syntax error, at errorPosition() in the expression
+   bool parse(const std::string_view &expression)
+   {
+      auto nodes = std::vector<PredicateNode> {};
+      auto parser = PredicateParser { expression, nodes };
+
+      if (!parser.parse()) {
+         mErrorPosition = parser.position();
+         return false;
+      }
+
+      mNodes = std::move(nodes);
+      return true;
+   }
+
+   size_t errorPosition() const
+   {
+      return mErrorPosition;
+   }
+
+   // A record with a tag or value running past its end matches nothing
+   bool evaluate(const std::string_view &record) const
+   {
+      if (mNodes.empty()) {
+         return true;
+      }
+
+      auto malformed = false;
+      auto result = evaluate(static_cast<unsigned>(mNodes.size() - 1), record, malformed);
+      return result && !malformed;
+   }
+
+   // Evaluates the predicate for count records
+   void evaluate(const std::string_view *records, size_t count, bool *results) const
+   {
+      for (auto i = size_t { 0 }; i < count; ++i) {
+         results[i] = evaluate(records[i]);
+      }
+   }
+
+   // Writes the indices of the matching records to matches, which has room
+   // for count indices, and returns how many matched
+   size_t select(const std::string_view *records, size_t count, size_t *matches) const
+   {
+      auto matched = size_t { 0 };
+
+      for (auto i = size_t { 0 }; i < count; ++i) {
+         // Branch free, most records are expected to be dropped
+         matches[matched] = i;
+         matched += evaluate(records[i]) ? 1 : 0;
+      }
+
+      return matched;
+   }
+
+   std::vector<size_t> select(const std::vector<std::string_view> &records) const
+   {
+      auto matches = std::vector<size_t>(records.size());
+      matches.resize(select(records.data(), records.size(), matches.data()));
+      return matches;
+   }
+
+private:
+   // An encoded value, read as the literals it is compared with need it
+   struct WireValue
+   {
+      unsigned type;
+      uint64_t bits;
+      std::string_view bytes;
+   };
+
+   // Sets malformed and stops at the first truncated tag or value, the
+   // result is dropped then
+   bool evaluate(unsigned index, const std::string_view &record, bool &malformed) const
+   {
+      auto &node = mNodes[index];
+
+      switch (node.kind) {
+      case PredicateNode::Kind::And:
+         return evaluate(node.left, record, malformed) && !malformed && evaluate(node.right, record, malformed);
+      case PredicateNode::Kind::Or:
+         return (evaluate(node.left, record, malformed) && !malformed) || (!malformed && evaluate(node.right, record, malformed));
+      case PredicateNode::Kind::Not:
+         return !evaluate(node.left, record, malformed);
+      default:
+         break;
+      }
+
+      if (node.kind == PredicateNode::Kind::Has || node.any) {
+         return findAny(node, record, 0, malformed);
+      }
+
+      auto value = WireValue {};
+      return matchValue(node, findLast(node, record, 0, value, malformed) ? &value : nullptr);
+   }
+
+   // Finds the occurrence of the field at node.path[depth] parse() would
+   // keep, the last one, descending into every occurrence of the sub
+   // messages on the path. Has to read the whole record.
+   bool findLast(const PredicateNode &node, const std::string_view &data, size_t depth, WireValue &value, bool &malformed) const
+   {
+      auto parser = Parser { data };
+      auto number = node.path[depth];
+      auto leaf = depth + 1 == node.path.size();
+      auto found = false;
+
+      while (!parser.eof()) {
+         auto tag = Parser::Tag {};
+
+         if (!readTag(parser, data, tag)) {
+            malformed = true;
+            return false;
+         }
+
+         if (tag.field != number || (!leaf && tag.type != Parser::WireType::LengthDelimited)) {
+            parser.skipField(tag.type);
+         } else if (leaf) {
+            found = readValue(parser, tag.type, value) || found;
+         } else {
+            auto message = parser.readMessage();
+
+            if (parser.position() <= data.size() && findLast(node, message, depth + 1, value, malformed)) {
+               found = true;
+            }
+         }
+
+         // Lengths are only checked once skipped, nothing is read before
+         if (malformed || parser.position() > data.size()) {
+            malformed = true;
+            return false;
+         }
+      }
+
+      return found;
+   }
+
+   // Walks the occurrences of the field at node.path[depth] until one
+   // matches, or for has() until there is one
+   bool findAny(const PredicateNode &node, const std::string_view &data, size_t depth, bool &malformed) const
+   {
+      auto parser = Parser { data };
+      auto number = node.path[depth];
+      auto leaf = depth + 1 == node.path.size();
+
+      while (!parser.eof()) {
+         auto tag = Parser::Tag {};
+
+         if (!readTag(parser, data, tag)) {
+            malformed = true;
+            return false;
+         }
+
+         auto matched = false;
+
+         if (tag.field != number || (!leaf && tag.type != Parser::WireType::LengthDelimited)) {
+            parser.skipField(tag.type);
+         } else if (leaf) {
+            auto value = WireValue {};
+            auto read = readValue(parser, tag.type, value);
+            matched = node.kind == PredicateNode::Kind::Has || (read && parser.position() <= data.size() && matchValue(node, &value));
+         } else {
+            auto message = parser.readMessage();
+            matched = parser.position() <= data.size() && findAny(node, message, depth + 1, malformed);
+         }
+
+         // Lengths are only checked once skipped, nothing is read before
+         if (malformed || parser.position() > data.size()) {
+            malformed = true;
+            return false;
+         }
+
+         if (matched) {
+            return true;
+         }
+      }
+
+      return false;
+   }
+
+   // Reads the next tag of data and checks that the tag, a varint or fixed
+   // value or a length after it end within data, Parser itself does not
+   // check, so a truncated record is never read past its end. Groups fail
+   // too, their end could only be found by walking them.
+   static bool readTag(Parser &parser, const std::string_view &data, Parser::Tag &tag)
+   {
+      // Parser reads a tag or a varint in at most 10 bytes, away from the end
+      // of data only the sizes of fixed values need checking
+      auto nearEnd = data.size() - parser.position() < 20;
+
+      if (nearEnd && !isTagComplete(data, parser.position())) {
+         return false;
+      }
+
+      tag = parser.readTag();
+
+      // Padding, which Parser::readTag() reads as the end of data
+      if (tag.field == 0) {
+         return parser.eof();
+      }
+
+      auto position = parser.position();
+
+      switch (tag.type) {
+      case Parser::WireType::VarInt:
+      case Parser::WireType::LengthDelimited:
+         return !nearEnd || isVarIntComplete(data, position);
+      case Parser::WireType::Fixed32:
+         return data.size() - position >= 4;
+      case Parser::WireType::Fixed64:
+         return data.size() - position >= 8;
+      default:
+         return false;
+      }
+   }
+
+   static bool isTagComplete(const std::string_view &data, size_t position)
+   {
+      auto padding = data.size() - position >= 2
+         && static_cast<uint8_t>(data[position]) == 0xff
+         && static_cast<uint8_t>(data[position + 1]) == 0xff;
+
+      return padding || isVarIntComplete(data, position);
+   }
+
+   // Whether the varint at position ends within data, in at most 10 bytes
+   // like Parser reads it
+   static bool isVarIntComplete(const std::string_view &data, size_t position)
+   {
+      for (auto i = position; i < data.size() && i < position + 10; ++i) {
+         if ((static_cast<uint8_t>(data[i]) & 0x80) == 0) {
+            return true;
+         }
+      }
+
+      return false;
+   }
+
+   // Reads the value of a field, groups have none and are skipped
+   static bool readValue(Parser &parser, unsigned type, WireValue &value)
+   {
+      value.type = type;
+
+      switch (type) {
+      case Parser::WireType::VarInt:
+         value.bits = parser.readVarUint64();
+         return true;
+      case Parser::WireType::Fixed32:
+         value.bits = parser.readFixed32();
+         return true;
+      case Parser::WireType::Fixed64:
+         value.bits = parser.readFixed64();
+         return true;
+      case Parser::WireType::LengthDelimited:
+         value.bytes = parser.readBytes();
+         return true;
+      default:
+         parser.skipField(type);
+         return false;
+      }
+   }
+
+   // Compares value, or the default value when it is null, with the
+   // literals of a Compare or In node
+   static bool matchValue(const PredicateNode &node, const WireValue *value)
+   {
+      for (auto &literal : node.values) {
+         auto order = 0;
+
+         if (!compareValue(node, value, literal, order)) {
+            continue;
+         }
+
+         if (node.kind == PredicateNode::Kind::In) {
+            if (order == 0) {
+               return true;
+            }
+
+            continue;
+         }
+
+         switch (node.op) {
+         case PredicateNode::Operator::Equal:
+            return order == 0;
+         case PredicateNode::Operator::NotEqual:
+            return order != 0;
+         case PredicateNode::Operator::Less:
+            return order < 0;
+         case PredicateNode::Operator::LessEqual:
+            return order <= 0;
+         case PredicateNode::Operator::Greater:
+            return order > 0;
+         case PredicateNode::Operator::GreaterEqual:
+            return order >= 0;
+         }
+      }
+
+      return false;
+   }
+
+   // Orders the value against the literal, fails when they can not be
+   // compared, like a string literal with a varint
+   static bool compareValue(const PredicateNode &node, const WireValue *value, const PredicateLiteral &literal, int &order)
+   {
+      switch (literal.kind) {
+      case PredicateLiteral::Kind::Integer:
+      {
+         auto integer = int64_t { 0 };
+
+         if (value) {
+            switch (value->type) {
+            case Parser::WireType::VarInt:
+               integer = node.cast == PredicateNode::Cast::Sint
+                  ? static_cast<int64_t>(Parser::zigZagDecode64(value->bits))
+                  : static_cast<int64_t>(value->bits);
+               break;
+            case Parser::WireType::Fixed32:
+               integer = node.cast == PredicateNode::Cast::Sfixed
+                  ? static_cast<int64_t>(static_cast<int32_t>(value->bits))
+                  : static_cast<int64_t>(value->bits);
+               break;
+            case Parser::WireType::Fixed64:
+               integer = static_cast<int64_t>(value->bits);
+
+               // Unsigned values past the signed range are greater than any literal
+               if (node.cast != PredicateNode::Cast::Sfixed && integer < 0) {
+                  order = 1;
+                  return true;
+               }
+
+               break;
+            default:
+               return false;
+            }
+         }
+
+         order = integer < literal.integer ? -1 : (integer > literal.integer ? 1 : 0);
+         return true;
+      }
+      case PredicateLiteral::Kind::Real:
+      {
+         auto real = 0.0;
+
+         if (value) {
+            switch (value->type) {
+            case Parser::WireType::VarInt:
+               real = static_cast<double>(static_cast<int64_t>(value->bits));
+               break;
+            case Parser::WireType::Fixed32:
+               real = bitCast<float>(static_cast<uint32_t>(value->bits));
+               break;
+            case Parser::WireType::Fixed64:
+               real = bitCast<double>(value->bits);
+               break;
+            default:
+               return false;
+            }
+         }
+
+         // NaN is unordered, it only compares unequal
+         order = real < literal.real ? -1 : (real > literal.real ? 1 : (real == literal.real ? 0 : 2));
+         return order != 2 || node.op == PredicateNode::Operator::NotEqual;
+      }
+      case PredicateLiteral::Kind::String:
+      {
+         if (value && value->type != Parser::WireType::LengthDelimited) {
+            return false;
+         }
+
+         auto bytes = value ? value->bytes : std::string_view {};
+         auto size = std::min(bytes.size(), literal.string.size());
+         auto compared = size ? std::memcmp(bytes.data(), literal.string.data(), size) : 0;
+
+         if (compared == 0) {
+            compared = bytes.size() < literal.string.size() ? -1 : (bytes.size() > literal.string.size() ? 1 : 0);
+         }
+
+         order = compared;
+         return true;
+      }
+      }
+
+      return false;
+   }
+
+private:
+   std::vector<PredicateNode> mNodes;
+   size_t mErrorPosition = 0;
+};
+
+}
@@ -0,0 +1,267 @@
+#pragma once
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <string_view.h>
+#include <pbsl/parser.h>
+
+// Declares the wire format of a plain struct without running the compiler:
+//
+//    struct Point { int32_t x; int32_t y; std::string_view label; };
+//
+//    using PointSchema = pbsl::Schema<
+//       pbsl::Field<1, PBSL_MEMBER(&Point::x)>,
+//       pbsl::Field<2, PBSL_MEMBER(&Point::y), pbsl::codec::Sint32>,
+//       pbsl::Field<3, PBSL_MEMBER(&Point::label)>>;
+//
+//    auto point = Point {};
+//    PointSchema::parse(data, point);
+//
+// The codec defaults to the one matching the member type, sint, fixed,
+// sfixed and bytes fields and sub messages name theirs. Members of type
+// std::vector are repeated fields and accept packed and unpacked elements.
+// Maps and oneofs are not supported.
+//
+// The decode loop reads a tag and compares its field number with those of
+// the schema in order. The compares and the reads are all inlined, which for
+// the handful of fields of a small protocol decodes about as fast as the
+// switch of a generated parse(), "bench schema" compares the two. Unlike the
+// generated parse(), unknown fields are skipped.
+#define PBSL_MEMBER(pointer) decltype(pointer), pointer
+
+namespace pbsl
+{
+
+namespace codec
+{
+
+template<typename Value, unsigned Wire, Value (Parser::*Read)()>
+struct Scalar
+{
+   using Type = Value;
+   static const unsigned WireType = Wire;
+
+   static bool read(Parser &parser, unsigned type, Value &value)
+   {
+      if (type != Wire) {
+         return false;
+      }
+
+      value = (parser.*Read)();
+      return true;
+   }
+};
+
+struct Double : Scalar<double, Parser::WireType::Fixed64, &Parser::readDouble> { };
+struct Float : Scalar<float, Parser::WireType::Fixed32, &Parser::readFloat> { };
+struct Int32 : Scalar<int32_t, Parser::WireType::VarInt, &Parser::readInt32> { };
+struct Int64 : Scalar<int64_t, Parser::WireType::VarInt, &Parser::readInt64> { };
+struct Uint32 : Scalar<uint32_t, Parser::WireType::VarInt, &Parser::readUint32> { };
+struct Uint64 : Scalar<uint64_t, Parser::WireType::VarInt, &Parser::readUint64> { };
+struct Sint32 : Scalar<int32_t, Parser::WireType::VarInt, &Parser::readSint32> { };
+struct Sint64 : Scalar<int64_t, Parser::WireType::VarInt, &Parser::readSint64> { };
+struct Fixed32 : Scalar<uint32_t, Parser::WireType::Fixed32, &Parser::readFixed32> { };
+struct Fixed64 : Scalar<uint64_t, Parser::WireType::Fixed64, &Parser::readFixed64> { };
+struct Sfixed32 : Scalar<int32_t, Parser::WireType::Fixed32, &Parser::readSfixed32> { };
+struct Sfixed64 : Scalar<int64_t, Parser::WireType::Fixed64, &Parser::readSfixed64> { };
+struct Bool : Scalar<bool, Parser::WireType::VarInt, &Parser::readBool> { };
+struct String : Scalar<std::string_view, Parser::WireType::LengthDelimited, &Parser::readString> { };
+struct Bytes : Scalar<std::string_view, Parser::WireType::LengthDelimited, &Parser::readBytes> { };
+
+template<typename Value>
+struct Enum
+{
+   using Type = Value;
+   static const unsigned WireType = Parser::WireType::VarInt;
+
+   static bool read(Parser &parser, unsigned type, Value &value)
+   {
+      if (type != WireType) {
+         return false;
+      }
+
+      value = static_cast<Value>(parser.readInt32());
+      return true;
+   }
+};
+
+// Sub message decoded with the Schema of its type
+template<typename MessageSchema>
+struct Message
+{
+   using Type = typename MessageSchema::Type;
+   static const unsigned WireType = Parser::WireType::LengthDelimited;
+
+   static bool read(Parser &parser, unsigned type, Type &value)
+   {
+      if (type != WireType) {
+         return false;
+      }
+
+      return MessageSchema::parse(parser.readMessage(), value);
+   }
+};
+
+// Elements are decoded into a local and appended, std::vector<bool> has no
+// element a reference could be taken to
+template<typename Element>
+struct Repeated
+{
+   using Type = std::vector<typename Element::Type>;
+   static const unsigned WireType = Element::WireType;
+
+   static bool read(Parser &parser, unsigned type, Type &values)
+   {
+      // Scalars may be packed into a single length delimited record
+      if (type == Parser::WireType::LengthDelimited && Element::WireType != Parser::WireType::LengthDelimited) {
+         auto packed = Parser { parser.readString() };
+
+         while (!packed.eof()) {
+            if (!readElement(packed, Element::WireType, values)) {
+               return false;
+            }
+         }
+
+         return true;
+      }
+
+      return readElement(parser, type, values);
+   }
+
+   static bool readElement(Parser &parser, unsigned type, Type &values)
+   {
+      auto value = typename Element::Type {};
+
+      if (!Element::read(parser, type, value)) {
+         return false;
+      }
+
+      values.push_back(std::move(value));
+      return true;
+   }
+};
+
+template<typename Value, typename Enable = void>
+struct Default;
+
+template<> struct Default<double> { using Type = Double; };
+template<> struct Default<float> { using Type = Float; };
+template<> struct Default<int32_t> { using Type = Int32; };
+template<> struct Default<int64_t> { using Type = Int64; };
+template<> struct Default<uint32_t> { using Type = Uint32; };
+template<> struct Default<uint64_t> { using Type = Uint64; };
+template<> struct Default<bool> { using Type = Bool; };
+template<> struct Default<std::string_view> { using Type = String; };
+
+template<typename Value>
+struct Default<Value, typename std::enable_if<std::is_enum<Value>::value>::type>
+{
+   using Type = Enum<Value>;
+};
+
+template<typename Value>
+struct Default<std::vector<Value>>
+{
+   using Type = Repeated<typename Default<Value>::Type>;
+};
+
+}
+
+template<typename Pointer>
+struct MemberTraits;
+
+template<typename Class, typename Value>
+struct MemberTraits<Value Class::*>
+{
+   using ClassType = Class;
+   using ValueType = Value;
+};
+
+template<unsigned Number, typename Pointer, Pointer Member, typename Codec = typename codec::Default<typename MemberTraits<Pointer>::ValueType>::Type>
+struct Field
+{
+   using Type = typename MemberTraits<Pointer>::ClassType;
+   static const unsigned FieldNumber = Number;
+
+   static_assert(Number > 0, "Field numbers start at 1");
+   static_assert(std::is_same<typename Codec::Type, typename MemberTraits<Pointer>::ValueType>::value, "Codec does not match the member type");
+
+   static bool read(Parser &parser, unsigned type, Type &value)
+   {
+      return Codec::read(parser, type, value.*Member);
+   }
+};
+
+template<typename... Fields>
+struct FieldDispatch;
+
+template<>
+struct FieldDispatch<>
+{
+   template<typename Type>
+   static bool read(Parser &parser, const Parser::Tag &tag, Type &)
+   {
+      parser.skipField(tag.type);
+      return true;
+   }
+
+   static constexpr bool hasField(unsigned)
+   {
+      return false;
+   }
+
+   static constexpr bool uniqueFields()
+   {
+      return true;
+   }
+};
+
+template<typename First, typename... Rest>
+struct FieldDispatch<First, Rest...>
+{
+   template<typename Type>
+   static bool read(Parser &parser, const Parser::Tag &tag, Type &value)
+   {
+      if (tag.field == First::FieldNumber) {
+         return First::read(parser, tag.type, value);
+      }
+
+      return FieldDispatch<Rest...>::read(parser, tag, value);
+   }
+
+   static constexpr bool hasField(unsigned number)
+   {
+      return number == First::FieldNumber || FieldDispatch<Rest...>::hasField(number);
+   }
+
+   static constexpr bool uniqueFields()
+   {
+      return !FieldDispatch<Rest...>::hasField(First::FieldNumber) && FieldDispatch<Rest...>::uniqueFields();
+   }
+};
+
+template<typename First, typename... Rest>
+struct Schema
+{
+   using Type = typename First::Type;
+
+   static_assert(FieldDispatch<First, Rest...>::uniqueFields(), "Field numbers must be unique");
+
+   static bool parse(const std::string_view &data, Type &value)
+   {
+      auto parser = Parser { data };
+
+      while (!parser.eof()) {
+         auto tag = parser.readTag();
+
+         if (!FieldDispatch<First, Rest...>::read(parser, tag, value)) {
+            return false;
+         }
+      }
+
+      return true;
+   }
+};
+
+}
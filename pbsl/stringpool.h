@@ -0,0 +1,123 @@
+#pragma once
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <string_view.h>
+
+namespace pbsl
+{
+
+// Single block of memory holding copies of all the string and bytes fields
+// of a decoded message tree, so the message no longer refers to its input.
+// The generated parseOwned() sizes it exactly with one allocation.
+class StringPool
+{
+public:
+   StringPool() :
+      mSize(0),
+      mCapacity(0)
+   {
+   }
+
+   StringPool(StringPool &&other) = default;
+   StringPool &operator=(StringPool &&other) = default;
+
+   size_t size() const
+   {
+      return mSize;
+   }
+
+   size_t capacity() const
+   {
+      return mCapacity;
+   }
+
+   // Releases all strings stored so far and makes room for exactly size
+   // bytes, the block is only reallocated when it is too small. Every view
+   // returned by store() before is invalid afterwards, it may point to freed
+   // memory or to strings stored later.
+   void reset(size_t size)
+   {
+      if (size > mCapacity) {
+         mData.reset(new char[size]);
+         mCapacity = size;
+      }
+
+      mSize = 0;
+   }
+
+   std::string_view store(const std::string_view &value)
+   {
+      assert(mSize + value.size() <= mCapacity);
+
+      if (value.empty()) {
+         return { };
+      }
+
+      auto data = mData.get() + mSize;
+      std::memcpy(data, value.data(), value.size());
+      mSize += value.size();
+      return { data, value.size() };
+   }
+
+private:
+   std::unique_ptr<char[]> mData;
+   size_t mSize;
+   size_t mCapacity;
+};
+
+// A message together with the pool owning its strings. Moving it keeps the
+// strings valid as they live on the heap, copying it is not possible.
+template<typename Type>
+class Owned
+{
+public:
+   Owned() :
+      mValue()
+   {
+   }
+
+   Owned(Owned &&other) = default;
+   Owned &operator=(Owned &&other) = default;
+
+   bool parse(const std::string_view &data)
+   {
+      return mValue.parseOwned(data, mPool);
+   }
+
+   Type &get()
+   {
+      return mValue;
+   }
+
+   const Type &get() const
+   {
+      return mValue;
+   }
+
+   Type &operator*()
+   {
+      return mValue;
+   }
+
+   const Type &operator*() const
+   {
+      return mValue;
+   }
+
+   Type *operator->()
+   {
+      return &mValue;
+   }
+
+   const Type *operator->() const
+   {
+      return &mValue;
+   }
+
+private:
+   StringPool mPool;
+   Type mValue;
+};
+
+}
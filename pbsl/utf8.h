@@ -0,0 +1,356 @@
+#pragma once
+#include <cstring>
+#include <stdint.h>
+#include <string_view.h>
+#include <pbsl/parser.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PBSL_UTF8_AVX2
+#elif defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#define PBSL_UTF8_SSSE3
+#endif
+
+namespace pbsl
+{
+
+// Scalar UTF-8 validation, rejects overlong encodings, surrogates and code
+// points above U+10FFFF. Usable in constant expressions.
+PBSL_CONSTEXPR bool isValidUtf8Scalar(const char *data, size_t size)
+{
+   auto position = size_t { 0 };
+
+   while (position < size) {
+      auto byte = static_cast<uint8_t>(data[position]);
+
+      if (byte < 0x80) {
+         position++;
+         continue;
+      }
+
+      auto length = size_t { 0 };
+      auto min = uint8_t { 0x80 };
+      auto max = uint8_t { 0xBF };
+
+      if (byte >= 0xC2 && byte <= 0xDF) {
+         length = 2;
+      } else if (byte >= 0xE0 && byte <= 0xEF) {
+         length = 3;
+         min = (byte == 0xE0) ? 0xA0 : 0x80;
+         max = (byte == 0xED) ? 0x9F : 0xBF;
+      } else if (byte >= 0xF0 && byte <= 0xF4) {
+         length = 4;
+         min = (byte == 0xF0) ? 0x90 : 0x80;
+         max = (byte == 0xF4) ? 0x8F : 0xBF;
+      } else {
+         return false;
+      }
+
+      if (size - position < length) {
+         return false;
+      }
+
+      // Only the first continuation byte has a narrower range
+      auto second = static_cast<uint8_t>(data[position + 1]);
+
+      if (second < min || second > max) {
+         return false;
+      }
+
+      for (auto i = size_t { 2 }; i < length; ++i) {
+         auto continuation = static_cast<uint8_t>(data[position + i]);
+
+         if (continuation < 0x80 || continuation > 0xBF) {
+            return false;
+         }
+      }
+
+      position += length;
+   }
+
+   return true;
+}
+
+#if defined(PBSL_UTF8_AVX2) || defined(PBSL_UTF8_SSSE3)
+
+namespace utf8
+{
+
+// Classification of each pair of adjacent bytes with three 16 entry tables
+// indexed by the high and low nibble of the first byte and the high nibble
+// of the second, see Keiser and Lemire, "Validating UTF-8 In Less Than One
+// Instruction Per Byte". A pair is invalid when all three share a bit.
+enum Error : uint8_t
+{
+   TooShort = 1 << 0,      // 11______ followed by 0_______ or 11______
+   TooLong = 1 << 1,       // 0_______ followed by 10______
+   Overlong3 = 1 << 2,     // 11100000 100_____
+   TooLarge = 1 << 3,      // 11110100 1001____ and above
+   Surrogate = 1 << 4,     // 11101101 101_____
+   Overlong2 = 1 << 5,     // 1100000_ 10______
+   TooLarge1000 = 1 << 6,  // 11110101 and above followed by 1000____
+   Overlong4 = 1 << 6,     // 11110000 1000____
+   TwoConts = 1 << 7,      // 10______ 10______, valid only inside 3 and 4 byte characters
+   Carry = TooShort | TooLong | TwoConts
+};
+
+#define PBSL_UTF8_BYTE_1_HIGH \
+   TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, \
+   TwoConts, TwoConts, TwoConts, TwoConts, \
+   TooShort | Overlong2, \
+   TooShort, \
+   TooShort | Overlong3 | Surrogate, \
+   TooShort | TooLarge | TooLarge1000 | Overlong4
+
+#define PBSL_UTF8_BYTE_1_LOW \
+   Carry | Overlong3 | Overlong2 | Overlong4, \
+   Carry | Overlong2, \
+   Carry, \
+   Carry, \
+   Carry | TooLarge, \
+   Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000, \
+   Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000, \
+   Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000, \
+   Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000, \
+   Carry | TooLarge | TooLarge1000 | Surrogate, \
+   Carry | TooLarge | TooLarge1000, \
+   Carry | TooLarge | TooLarge1000
+
+#define PBSL_UTF8_BYTE_2_HIGH \
+   TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, \
+   TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge1000 | Overlong4, \
+   TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge, \
+   TooLong | Overlong2 | TwoConts | Surrogate | TooLarge, \
+   TooLong | Overlong2 | TwoConts | Surrogate | TooLarge, \
+   TooShort, TooShort, TooShort, TooShort
+
+#if defined(PBSL_UTF8_AVX2)
+
+using Block = __m256i;
+static const auto BlockSize = size_t { 32 };
+
+inline Block load(const char *data)
+{
+   return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+}
+
+inline bool isAscii(Block input)
+{
+   return _mm256_movemask_epi8(input) == 0;
+}
+
+inline bool isZero(Block value)
+{
+   return _mm256_testz_si256(value, value) != 0;
+}
+
+inline Block highNibbles(Block input)
+{
+   return _mm256_and_si256(_mm256_srli_epi16(input, 4), _mm256_set1_epi8(0x0f));
+}
+
+inline Block lowNibbles(Block input)
+{
+   return _mm256_and_si256(input, _mm256_set1_epi8(0x0f));
+}
+
+// The input shifted right by N bytes with the end of previous shifted in
+template<int N>
+inline Block previous(Block input, Block previous)
+{
+   return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - N);
+}
+
+inline Block checkSpecialCases(Block input, Block previous1)
+{
+   const auto byte1HighTable = _mm256_setr_epi8(PBSL_UTF8_BYTE_1_HIGH, PBSL_UTF8_BYTE_1_HIGH);
+   const auto byte1LowTable = _mm256_setr_epi8(PBSL_UTF8_BYTE_1_LOW, PBSL_UTF8_BYTE_1_LOW);
+   const auto byte2HighTable = _mm256_setr_epi8(PBSL_UTF8_BYTE_2_HIGH, PBSL_UTF8_BYTE_2_HIGH);
+
+   auto byte1High = _mm256_shuffle_epi8(byte1HighTable, highNibbles(previous1));
+   auto byte1Low = _mm256_shuffle_epi8(byte1LowTable, lowNibbles(previous1));
+   auto byte2High = _mm256_shuffle_epi8(byte2HighTable, highNibbles(input));
+   return _mm256_and_si256(_mm256_and_si256(byte1High, byte1Low), byte2High);
+}
+
+// Two continuations in a row are only allowed as the 2nd and 3rd byte after
+// a 3 or 4 byte lead, the special cases flagged them with TwoConts
+inline Block checkMultibyteLengths(Block input, Block previousInput, Block specialCases)
+{
+   auto previous2 = previous<2>(input, previousInput);
+   auto previous3 = previous<3>(input, previousInput);
+   auto isThirdByte = _mm256_subs_epu8(previous2, _mm256_set1_epi8(static_cast<char>(0xe0 - 0x80)));
+   auto isFourthByte = _mm256_subs_epu8(previous3, _mm256_set1_epi8(static_cast<char>(0xf0 - 0x80)));
+   auto mustBeContinuation = _mm256_and_si256(_mm256_or_si256(isThirdByte, isFourthByte), _mm256_set1_epi8(static_cast<char>(0x80)));
+   return _mm256_xor_si256(mustBeContinuation, specialCases);
+}
+
+// Non zero when the block ends inside a multi byte character
+inline Block checkIncomplete(Block input)
+{
+   const auto maxValue = _mm256_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      static_cast<char>(0xf0 - 1), static_cast<char>(0xe0 - 1), static_cast<char>(0xc0 - 1));
+   return _mm256_subs_epu8(input, maxValue);
+}
+
+inline Block zero()
+{
+   return _mm256_setzero_si256();
+}
+
+inline Block orBlocks(Block a, Block b)
+{
+   return _mm256_or_si256(a, b);
+}
+
+#else
+
+using Block = __m128i;
+static const auto BlockSize = size_t { 16 };
+
+inline Block load(const char *data)
+{
+   return _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+}
+
+inline bool isAscii(Block input)
+{
+   return _mm_movemask_epi8(input) == 0;
+}
+
+inline bool isZero(Block value)
+{
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(value, _mm_setzero_si128())) == 0xffff;
+}
+
+inline Block highNibbles(Block input)
+{
+   return _mm_and_si128(_mm_srli_epi16(input, 4), _mm_set1_epi8(0x0f));
+}
+
+inline Block lowNibbles(Block input)
+{
+   return _mm_and_si128(input, _mm_set1_epi8(0x0f));
+}
+
+template<int N>
+inline Block previous(Block input, Block previous)
+{
+   return _mm_alignr_epi8(input, previous, 16 - N);
+}
+
+inline Block checkSpecialCases(Block input, Block previous1)
+{
+   const auto byte1HighTable = _mm_setr_epi8(PBSL_UTF8_BYTE_1_HIGH);
+   const auto byte1LowTable = _mm_setr_epi8(PBSL_UTF8_BYTE_1_LOW);
+   const auto byte2HighTable = _mm_setr_epi8(PBSL_UTF8_BYTE_2_HIGH);
+
+   auto byte1High = _mm_shuffle_epi8(byte1HighTable, highNibbles(previous1));
+   auto byte1Low = _mm_shuffle_epi8(byte1LowTable, lowNibbles(previous1));
+   auto byte2High = _mm_shuffle_epi8(byte2HighTable, highNibbles(input));
+   return _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+}
+
+inline Block checkMultibyteLengths(Block input, Block previousInput, Block specialCases)
+{
+   auto previous2 = previous<2>(input, previousInput);
+   auto previous3 = previous<3>(input, previousInput);
+   auto isThirdByte = _mm_subs_epu8(previous2, _mm_set1_epi8(static_cast<char>(0xe0 - 0x80)));
+   auto isFourthByte = _mm_subs_epu8(previous3, _mm_set1_epi8(static_cast<char>(0xf0 - 0x80)));
+   auto mustBeContinuation = _mm_and_si128(_mm_or_si128(isThirdByte, isFourthByte), _mm_set1_epi8(static_cast<char>(0x80)));
+   return _mm_xor_si128(mustBeContinuation, specialCases);
+}
+
+inline Block checkIncomplete(Block input)
+{
+   const auto maxValue = _mm_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      static_cast<char>(0xf0 - 1), static_cast<char>(0xe0 - 1), static_cast<char>(0xc0 - 1));
+   return _mm_subs_epu8(input, maxValue);
+}
+
+inline Block zero()
+{
+   return _mm_setzero_si128();
+}
+
+inline Block orBlocks(Block a, Block b)
+{
+   return _mm_or_si128(a, b);
+}
+
+#endif
+
+#undef PBSL_UTF8_BYTE_1_HIGH
+#undef PBSL_UTF8_BYTE_1_LOW
+#undef PBSL_UTF8_BYTE_2_HIGH
+
+// Errors accumulate over all blocks and are tested once at the end
+class Validator
+{
+public:
+   void check(Block input)
+   {
+      if (isAscii(input)) {
+         // A character cut off by the previous block can not continue here
+         mError = orBlocks(mError, mPreviousIncomplete);
+      } else {
+         auto specialCases = checkSpecialCases(input, previous<1>(input, mPreviousInput));
+         mError = orBlocks(mError, checkMultibyteLengths(input, mPreviousInput, specialCases));
+         mPreviousIncomplete = checkIncomplete(input);
+      }
+
+      mPreviousInput = input;
+   }
+
+   bool valid() const
+   {
+      return isZero(orBlocks(mError, mPreviousIncomplete));
+   }
+
+private:
+   Block mError = zero();
+   Block mPreviousInput = zero();
+   Block mPreviousIncomplete = zero();
+};
+
+} // namespace utf8
+
+inline bool isValidUtf8Simd(const char *data, size_t size)
+{
+   auto validator = utf8::Validator {};
+   auto position = size_t { 0 };
+
+   for (; position + utf8::BlockSize <= size; position += utf8::BlockSize) {
+      validator.check(utf8::load(data + position));
+   }
+
+   // The tail is padded with zeros, an unfinished character fails as TooShort
+   if (position < size) {
+      char tail[utf8::BlockSize] = { };
+      std::memcpy(tail, data + position, size - position);
+      validator.check(utf8::load(tail));
+   }
+
+   return validator.valid();
+}
+
+#endif
+
+// Validates string fields with the widest kernel enabled at compile time,
+// short strings are not worth setting up the vector tables for.
+inline bool isValidUtf8(const std::string_view &value)
+{
+#if defined(PBSL_UTF8_AVX2) || defined(PBSL_UTF8_SSSE3)
+   if (value.size() >= 16) {
+      return isValidUtf8Simd(value.data(), value.size());
+   }
+#endif
+
+   return isValidUtf8Scalar(value.data(), value.size());
+}
+
+} // namespace pbsl
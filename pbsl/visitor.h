@@ -0,0 +1,69 @@
+#pragma once
+#include <pbsl/parser.h>
+
+namespace pbsl
+{
+
+// Returned by visitor hooks. Skip only has an effect from onBegin(), where it
+// skips the sub message without decoding it, Stop ends visit() early.
+enum class Visit
+{
+   Continue,
+   Skip,
+   Stop
+};
+
+// Returned by the generated visit(), Stopped when a hook returned Visit::Stop
+// and Failed when the input could not be decoded
+enum class VisitResult
+{
+   Done,
+   Stopped,
+   Failed
+};
+
+// Hooks called by the generated Message::visit(data, visitor) as the fields
+// go by, in wire order and without decoding into the message:
+//
+// onField<Message, N>(value)       for each value of field N, repeated
+//                                  fields once per element and packed_view
+//                                  fields once with the whole view
+// onField<Message, N>(key, value)  for each entry of map field N, message
+//                                  values are passed still encoded
+// onBegin<Message, N>()            before a sub message of field N, its
+//                                  fields are visited next
+// onEnd<Message, N>()              after the sub message of field N
+//
+// visit() is declared with every message and defined in the generated
+// <name>.pbsl.visit.h, include it to call visit().
+//
+// Derive from Visitor to only implement the hooks of interest, with
+// "using pbsl::Visitor::onField;" when overloading onField.
+struct Visitor
+{
+   template<typename Message, unsigned Field, typename Value>
+   Visit onField(const Value &)
+   {
+      return Visit::Continue;
+   }
+
+   template<typename Message, unsigned Field, typename Key, typename Value>
+   Visit onField(const Key &, const Value &)
+   {
+      return Visit::Continue;
+   }
+
+   template<typename Message, unsigned Field>
+   Visit onBegin()
+   {
+      return Visit::Continue;
+   }
+
+   template<typename Message, unsigned Field>
+   Visit onEnd()
+   {
+      return Visit::Continue;
+   }
+};
+
+}
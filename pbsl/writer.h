@@ -0,0 +1,370 @@
+#pragma once
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <string_view.h>
+#include <pbsl/parser.h>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+namespace pbsl
+{
+
+#ifdef _WIN32
+struct IoVec
+{
+   void *iov_base;
+   size_t iov_len;
+};
+#else
+using IoVec = iovec;
+#endif
+
+// Encodes into a buffer, appending to what it already holds. In gather mode
+// strings and bytes of at least the gather threshold are not copied, the
+// output is instead a list of segments for writev() or sendmsg() that
+// alternates between the scratch buffer, holding tags, lengths and small
+// values, and the referenced strings. These must outlive the segments.
+// Several messages go into one list by writing them all with one Writer.
+class Writer
+{
+public:
+   static const size_t DefaultGatherThreshold = 512;
+
+   Writer(std::string &buffer) :
+      mBuffer(buffer),
+      mSegments(nullptr),
+      mGatherThreshold(0),
+      mGatheredSize(0),
+      mBufferStart(buffer.size()),
+      mScratchStart(buffer.size())
+   {
+   }
+
+   Writer(std::string &scratch, std::vector<IoVec> &segments, size_t gatherThreshold = DefaultGatherThreshold) :
+      mBuffer(scratch),
+      mSegments(&segments),
+      mGatherThreshold(gatherThreshold),
+      mGatheredSize(0),
+      mBufferStart(scratch.size()),
+      mScratchStart(scratch.size())
+   {
+   }
+
+   // Number of bytes written by this writer, referenced strings included
+   size_t size() const
+   {
+      return mBuffer.size() - mBufferStart + mGatheredSize;
+   }
+
+   // Appends the segment of the scratch buffer written since the last
+   // referenced string and points the scratch segments at the buffer, which
+   // no longer moves. Call once everything is written, before using the
+   // segments. Writing more reallocates the scratch buffer, call finish()
+   // again afterwards, it points every scratch segment of this writer anew.
+   void finish()
+   {
+      if (!mSegments) {
+         return;
+      }
+
+      closeScratch();
+
+      for (auto &scratch : mScratchSegments) {
+         (*mSegments)[scratch.first].iov_base = &mBuffer[scratch.second];
+      }
+   }
+
+   void writeTag(unsigned field, unsigned type)
+   {
+      writeVarUint32((field << Parser::TagTypeBits) | type);
+   }
+
+   void writeFloat(float value)
+   {
+      uint32_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      writeFixed32(bits);
+   }
+
+   void writeDouble(double value)
+   {
+      uint64_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      writeFixed64(bits);
+   }
+
+   // Negative values are sign extended to 64 bits, as required by the wire format
+   void writeInt32(int32_t value)
+   {
+      writeVarUint64(static_cast<uint64_t>(static_cast<int64_t>(value)));
+   }
+
+   void writeInt64(int64_t value)
+   {
+      writeVarUint64(static_cast<uint64_t>(value));
+   }
+
+   void writeUint32(uint32_t value)
+   {
+      writeVarUint32(value);
+   }
+
+   void writeUint64(uint64_t value)
+   {
+      writeVarUint64(value);
+   }
+
+   void writeSint32(int32_t value)
+   {
+      writeVarUint32(zigZagEncode32(value));
+   }
+
+   void writeSint64(int64_t value)
+   {
+      writeVarUint64(zigZagEncode64(value));
+   }
+
+   void writeFixed32(uint32_t value)
+   {
+      char bytes[4];
+
+      for (auto i = 0u; i < 4; ++i) {
+         bytes[i] = static_cast<char>(value >> (i * 8));
+      }
+
+      mBuffer.append(bytes, 4);
+   }
+
+   void writeFixed64(uint64_t value)
+   {
+      char bytes[8];
+
+      for (auto i = 0u; i < 8; ++i) {
+         bytes[i] = static_cast<char>(value >> (i * 8));
+      }
+
+      mBuffer.append(bytes, 8);
+   }
+
+   void writeSfixed32(int32_t value)
+   {
+      writeFixed32(static_cast<uint32_t>(value));
+   }
+
+   void writeSfixed64(int64_t value)
+   {
+      writeFixed64(static_cast<uint64_t>(value));
+   }
+
+   void writeBool(bool value)
+   {
+      mBuffer.push_back(value ? 1 : 0);
+   }
+
+   void writeString(const std::string_view &value)
+   {
+      writeVarUint32(static_cast<uint32_t>(value.size()));
+
+      if (mSegments && value.size() >= mGatherThreshold) {
+         gather(value);
+      } else {
+         mBuffer.append(value.data(), value.size());
+      }
+   }
+
+   void writeBytes(const std::string_view &value)
+   {
+      writeString(value);
+   }
+
+   // Always copied, encoded messages are usually temporaries
+   void writeMessage(const std::string_view &value)
+   {
+      writeVarUint32(static_cast<uint32_t>(value.size()));
+      mBuffer.append(value.data(), value.size());
+   }
+
+   void writeVarUint32(uint32_t value)
+   {
+      writeVarUint64(value);
+   }
+
+   void writeVarUint64(uint64_t value)
+   {
+      char bytes[10];
+      auto size = 0u;
+
+      while (value >= 0x80) {
+         bytes[size++] = static_cast<char>(value | 0x80);
+         value >>= 7;
+      }
+
+      bytes[size++] = static_cast<char>(value);
+      mBuffer.append(bytes, size);
+   }
+
+   static size_t varIntSize(uint64_t value)
+   {
+      auto size = size_t { 1 };
+
+      while (value >= 0x80) {
+         value >>= 7;
+         size++;
+      }
+
+      return size;
+   }
+
+   // Encoded sizes of the values written by the matching write functions,
+   // without their tag
+   static size_t sizeFloat(float)
+   {
+      return 4;
+   }
+
+   static size_t sizeDouble(double)
+   {
+      return 8;
+   }
+
+   static size_t sizeInt32(int32_t value)
+   {
+      return varIntSize(static_cast<uint64_t>(static_cast<int64_t>(value)));
+   }
+
+   static size_t sizeInt64(int64_t value)
+   {
+      return varIntSize(static_cast<uint64_t>(value));
+   }
+
+   static size_t sizeUint32(uint32_t value)
+   {
+      return varIntSize(value);
+   }
+
+   static size_t sizeUint64(uint64_t value)
+   {
+      return varIntSize(value);
+   }
+
+   static size_t sizeSint32(int32_t value)
+   {
+      return varIntSize(zigZagEncode32(value));
+   }
+
+   static size_t sizeSint64(int64_t value)
+   {
+      return varIntSize(zigZagEncode64(value));
+   }
+
+   static size_t sizeFixed32(uint32_t)
+   {
+      return 4;
+   }
+
+   static size_t sizeFixed64(uint64_t)
+   {
+      return 8;
+   }
+
+   static size_t sizeSfixed32(int32_t)
+   {
+      return 4;
+   }
+
+   static size_t sizeSfixed64(int64_t)
+   {
+      return 8;
+   }
+
+   static size_t sizeBool(bool)
+   {
+      return 1;
+   }
+
+   static size_t sizeString(const std::string_view &value)
+   {
+      return varIntSize(value.size()) + value.size();
+   }
+
+   static size_t sizeBytes(const std::string_view &value)
+   {
+      return sizeString(value);
+   }
+
+   static size_t sizeMessage(size_t size)
+   {
+      return varIntSize(size) + size;
+   }
+
+   static uint32_t zigZagEncode32(int32_t value)
+   {
+      return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+   }
+
+   static uint64_t zigZagEncode64(int64_t value)
+   {
+      return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+   }
+
+private:
+   void gather(const std::string_view &value)
+   {
+      closeScratch();
+      mSegments->push_back(IoVec { const_cast<char *>(value.data()), value.size() });
+      mGatheredSize += value.size();
+   }
+
+   // The scratch buffer may still grow, its segments are recorded by offset
+   // and resolved by finish()
+   void closeScratch()
+   {
+      if (mBuffer.size() > mScratchStart) {
+         mScratchSegments.emplace_back(mSegments->size(), mScratchStart);
+         mSegments->push_back(IoVec { nullptr, mBuffer.size() - mScratchStart });
+         mScratchStart = mBuffer.size();
+      }
+   }
+
+private:
+   std::string &mBuffer;
+   std::vector<IoVec> *mSegments;
+   size_t mGatherThreshold;
+   size_t mGatheredSize;
+   size_t mBufferStart;
+   size_t mScratchStart;
+   std::vector<std::pair<size_t, size_t>> mScratchSegments;
+};
+
+// byteSize() caches the sizes serializeCached() writes the message with, in
+// the message, so a message shared between threads must not be serialized by
+// several of them at once
+template<typename Type>
+std::string serialize(const Type &message)
+{
+   auto data = std::string {};
+   data.reserve(message.byteSize());
+   auto writer = Writer { data };
+   message.serializeCached(writer);
+   return data;
+}
+
+// Appends the encoded message to segments, large strings and bytes point
+// into the message and scratch holds everything else. The segments point
+// into scratch, anything appended to scratch afterwards may reallocate it and
+// leave them dangling. To gather several messages into one list serialize()
+// them all with one gather mode Writer and finish() it after the last one.
+template<typename Type>
+void serialize(const Type &message, std::string &scratch, std::vector<IoVec> &segments, size_t gatherThreshold = Writer::DefaultGatherThreshold)
+{
+   auto writer = Writer { scratch, segments, gatherThreshold };
+   message.serialize(writer);
+   writer.finish();
+}
+
+}
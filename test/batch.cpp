@@ -0,0 +1,72 @@
+#include <pbsl/batch.h>
+#include <pbsl/writer.h>
+#include <string>
+#include <vector>
+#include "test.h"
+
+// A message decoded field by field like the generated ones, records with a
+// field number above 2 are invalid
+struct Entry
+{
+   uint32_t id;
+   std::vector<uint32_t> values;
+
+   bool parseField(pbsl::Parser &parser)
+   {
+      auto tag = parser.readTag();
+
+      switch (tag.field) {
+      case 1:
+         id = parser.readUint32();
+         return true;
+      case 2:
+         values.push_back(parser.readUint32());
+         return true;
+      default:
+         return false;
+      }
+   }
+};
+
+void testBatch()
+{
+   // Records of different lengths so the lanes finish out of order, record
+   // 5 is invalid
+   auto encoded = std::vector<std::string>(37);
+
+   for (auto i = 0u; i < encoded.size(); ++i) {
+      auto writer = pbsl::Writer { encoded[i] };
+      writer.writeTag(1, pbsl::Parser::WireType::VarInt);
+      writer.writeUint32(i);
+
+      for (auto j = 0u; j < i % 7; ++j) {
+         writer.writeTag(i == 5 ? 3 : 2, pbsl::Parser::WireType::VarInt);
+         writer.writeUint32(j);
+      }
+   }
+
+   auto records = std::vector<std::string_view>(encoded.begin(), encoded.end());
+
+   for (auto lanes : { 1, 3, 4, 64 }) {
+      // Left over values, every message is reset before it is decoded
+      auto messages = std::vector<Entry>(records.size(), Entry { 99, { 1, 2, 3 } });
+      bool results[37];
+
+      CHECK(pbsl::parseBatch(records.data(), records.size(), messages.data(), results, 2, lanes) == records.size() - 1);
+
+      for (auto i = 0u; i < records.size(); ++i) {
+         CHECK(results[i] == (i != 5));
+         CHECK(messages[i].id == i);
+
+         if (i != 5) {
+            CHECK(messages[i].values.size() == i % 7);
+         }
+      }
+   }
+
+   auto messages = std::vector<Entry>(3, Entry { 99, { 1 } });
+   CHECK(pbsl::parseBatch(records, messages) == records.size() - 1);
+   CHECK(messages.size() == records.size());
+   CHECK(messages[1].values.size() == 1);
+   CHECK(pbsl::parseBatch(records.data(), 0, messages.data()) == 0);
+}
@@ -0,0 +1,136 @@
+#include <pbsl/writer.h>
+#include "dynamicmessage.h"
+#include "test.h"
+
+// dynamic.proto is found next to this file, wherever the test runs from
+static std::string getProtoPath()
+{
+   auto path = std::string { __FILE__ };
+   auto slash = path.find_last_of("/\\");
+   return (slash == std::string::npos ? std::string {} : path.substr(0, slash + 1)) + "dynamic.proto";
+}
+
+static std::string encodeEntry(int32_t delta, const std::string_view &label)
+{
+   auto buffer = std::string {};
+   auto writer = pbsl::Writer { buffer };
+   writer.writeTag(1, pbsl::Parser::WireType::VarInt);
+   writer.writeSint32(delta);
+   writer.writeTag(2, pbsl::Parser::WireType::LengthDelimited);
+   writer.writeString(label);
+   return buffer;
+}
+
+void testDynamic()
+{
+   auto schema = pbsl::DynamicSchema {};
+   CHECK(schema.load(getProtoPath()));
+
+   auto type = schema.find("Record");
+   CHECK(type != nullptr);
+
+   if (!type) {
+      return;
+   }
+
+   CHECK(schema.find("Entry") != nullptr);
+   CHECK(schema.find("Missing") == nullptr);
+
+   auto packed = std::string {};
+   auto packedWriter = pbsl::Writer { packed };
+   packedWriter.writeUint32(2);
+   packedWriter.writeUint32(300);
+
+   auto mapEntry = std::string {};
+   auto mapWriter = pbsl::Writer { mapEntry };
+   mapWriter.writeTag(1, pbsl::Parser::WireType::LengthDelimited);
+   mapWriter.writeString("key");
+   mapWriter.writeTag(2, pbsl::Parser::WireType::LengthDelimited);
+   mapWriter.writeMessage(encodeEntry(-5, "mapped"));
+
+   // One unpacked and one packed record of values, an unknown field and
+   // both oneof alternatives, the last one wins
+   auto buffer = std::string {};
+   auto writer = pbsl::Writer { buffer };
+   writer.writeTag(1, pbsl::Parser::WireType::VarInt);
+   writer.writeInt32(42);
+   writer.writeTag(2, pbsl::Parser::WireType::LengthDelimited);
+   writer.writeString("record");
+   writer.writeTag(3, pbsl::Parser::WireType::VarInt);
+   writer.writeUint32(1);
+   writer.writeTag(3, pbsl::Parser::WireType::LengthDelimited);
+   writer.writeBytes(packed);
+   writer.writeTag(4, pbsl::Parser::WireType::LengthDelimited);
+   writer.writeMessage(encodeEntry(-3, "entry"));
+   writer.writeTag(5, pbsl::Parser::WireType::LengthDelimited);
+   writer.writeMessage(mapEntry);
+   writer.writeTag(99, pbsl::Parser::WireType::VarInt);
+   writer.writeUint32(7);
+   writer.writeTag(7, pbsl::Parser::WireType::VarInt);
+   writer.writeInt32(1);
+   writer.writeTag(8, pbsl::Parser::WireType::LengthDelimited);
+   writer.writeString("text");
+
+   pbsl::Arena arena;
+   auto message = pbsl::DynamicMessage::parse(*type, buffer, arena);
+   CHECK(message != nullptr);
+
+   if (!message) {
+      return;
+   }
+
+   auto &id = *type->findField("id");
+   auto &name = *type->findField("name");
+   auto &values = *type->findField("values");
+   auto &entry = *type->findField("entry");
+   auto &byName = *type->findField("byName");
+   auto &ratio = *type->findField("ratio");
+   auto &code = *type->findField("code");
+   auto &text = *type->findField("text");
+
+   CHECK(message->getInteger(id) == 42);
+   CHECK(message->getString(name) == "record");
+   CHECK(message->size(values) == 3);
+   CHECK(message->getUnsigned(values, 0) == 1);
+   CHECK(message->getUnsigned(values, 2) == 300);
+   CHECK(!message->has(ratio));
+   CHECK(message->getReal(ratio) == 0.0);
+
+   auto sub = message->getMessage(entry);
+   CHECK(sub && sub->getInteger(*sub->type().findField("delta")) == -3);
+   CHECK(sub && sub->getString(*sub->type().findField("label")) == "entry");
+
+   CHECK(message->size(byName) == 1);
+   auto pair = message->getMessage(byName, 0);
+   CHECK(pair && pair->getString(*pair->type().findField("key")) == "key");
+
+   CHECK(!message->has(code));
+   CHECK(message->has(text));
+   CHECK(message->oneofField(0) == &text);
+   CHECK(message->getString(text) == "text");
+
+   // A singular message occurring again is merged with the earlier one
+   auto label = std::string {};
+   auto labelWriter = pbsl::Writer { label };
+   labelWriter.writeTag(2, pbsl::Parser::WireType::LengthDelimited);
+   labelWriter.writeString("x");
+
+   auto merged = std::string {};
+   auto mergedWriter = pbsl::Writer { merged };
+   mergedWriter.writeTag(4, pbsl::Parser::WireType::LengthDelimited);
+   mergedWriter.writeMessage(encodeEntry(-3, "entry"));
+   mergedWriter.writeTag(4, pbsl::Parser::WireType::LengthDelimited);
+   mergedWriter.writeMessage(label);
+
+   auto mergedMessage = pbsl::DynamicMessage::parse(*type, merged, arena);
+   auto mergedEntry = mergedMessage ? mergedMessage->getMessage(entry) : nullptr;
+   CHECK(mergedEntry && mergedEntry->getInteger(*mergedEntry->type().findField("delta")) == -3);
+   CHECK(mergedEntry && mergedEntry->getString(*mergedEntry->type().findField("label")) == "x");
+
+   // A field with the wrong wire type fails the whole message
+   auto invalid = std::string {};
+   auto invalidWriter = pbsl::Writer { invalid };
+   invalidWriter.writeTag(2, pbsl::Parser::WireType::VarInt);
+   invalidWriter.writeUint32(1);
+   CHECK(pbsl::DynamicMessage::parse(*type, invalid, arena) == nullptr);
+}
@@ -0,0 +1,36 @@
+#include <pbsl/intern.h>
+#include "test.h"
+
+void testIntern()
+{
+   auto global = pbsl::intern("label");
+   CHECK(global == pbsl::intern("label"));
+   CHECK(global.view() == "label");
+
+   pbsl::InternTable table;
+   auto defaultSize = pbsl::defaultInternTable().size();
+
+   {
+      pbsl::InternScope scope { table };
+      auto scoped = pbsl::intern("label");
+
+      // Same text, but owned by the scoped table
+      CHECK(scoped != global);
+      CHECK(scoped == pbsl::intern("label"));
+      CHECK(scoped.view() == global.view());
+
+      {
+         pbsl::InternTable other;
+         pbsl::InternScope inner { other };
+         CHECK(pbsl::intern("label") != scoped);
+         CHECK(other.size() == 1);
+      }
+
+      // The enclosing table is used again once the inner scope ends
+      CHECK(pbsl::intern("other") != pbsl::intern("label"));
+      CHECK(table.size() == 2);
+   }
+
+   CHECK(pbsl::defaultInternTable().size() == defaultSize);
+   CHECK(pbsl::intern("label") == global);
+}
@@ -0,0 +1,22 @@
+#include "test.h"
+
+int CheckFailures = 0;
+
+int main()
+{
+   testPatcher();
+   testIntern();
+   testSchema();
+   testDynamic();
+   testPredicate();
+   testBatch();
+   testWriter();
+
+   if (CheckFailures) {
+      std::cout << CheckFailures << " checks failed" << std::endl;
+      return -1;
+   }
+
+   std::cout << "All checks passed" << std::endl;
+   return 0;
+}
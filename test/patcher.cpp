@@ -0,0 +1,92 @@
+#include <pbsl/patcher.h>
+#include "test.h"
+
+// Reads the last value of a varint field like a parse() does, merging every
+// occurrence of the sub messages on the path
+static bool readLastVarInt(const std::string_view &data, const unsigned *path, size_t depth, uint64_t &value)
+{
+   auto parser = pbsl::Parser { data };
+   auto found = false;
+
+   while (!parser.eof()) {
+      auto tag = parser.readTag();
+
+      if (tag.field != path[0]) {
+         parser.skipField(tag.type);
+      } else if (depth == 1) {
+         value = parser.readVarUint64();
+         found = true;
+      } else {
+         found = readLastVarInt(parser.readMessage(), path + 1, depth - 1, value) || found;
+      }
+   }
+
+   return found;
+}
+
+static uint64_t readLastVarInt(const std::string &data, const std::initializer_list<unsigned> &path)
+{
+   auto value = uint64_t { 0 };
+   readLastVarInt(data, path.begin(), path.size(), value);
+   return value;
+}
+
+void testPatcher()
+{
+   auto inner1 = std::string {};
+   auto inner1Writer = pbsl::Writer { inner1 };
+   inner1Writer.writeTag(3, pbsl::Parser::WireType::VarInt);
+   inner1Writer.writeVarUint32(1);
+
+   auto inner2 = std::string {};
+   auto inner2Writer = pbsl::Writer { inner2 };
+   inner2Writer.writeTag(5, pbsl::Parser::WireType::VarInt);
+   inner2Writer.writeVarUint32(2);
+
+   // Field 1 and sub message 2 both occur twice
+   auto buffer = std::string {};
+   auto writer = pbsl::Writer { buffer };
+   writer.writeTag(1, pbsl::Parser::WireType::VarInt);
+   writer.writeVarUint32(5);
+   writer.writeTag(2, pbsl::Parser::WireType::LengthDelimited);
+   writer.writeMessage(inner1);
+   writer.writeTag(1, pbsl::Parser::WireType::VarInt);
+   writer.writeVarUint32(7);
+   writer.writeTag(2, pbsl::Parser::WireType::LengthDelimited);
+   writer.writeMessage(inner2);
+
+   auto patcher = pbsl::Patcher { buffer };
+
+   // The last duplicate is the one a parse() keeps
+   CHECK(patcher.setUint32({ 1 }, 300));
+   CHECK(readLastVarInt(buffer, { 1 }) == 300);
+
+   // Only the first occurrence of sub message 2 has field 3
+   CHECK(patcher.setUint32({ 2, 3 }, 1000));
+   CHECK(readLastVarInt(buffer, { 2, 3 }) == 1000);
+   CHECK(readLastVarInt(buffer, { 2, 5 }) == 2);
+
+   // Missing fields are appended to the last occurrence
+   CHECK(patcher.setUint32({ 2, 4 }, 9));
+   CHECK(readLastVarInt(buffer, { 2, 4 }) == 9);
+   CHECK(readLastVarInt(buffer, { 1 }) == 300);
+
+   CHECK(!patcher.setUint32({ 6, 1 }, 1));
+   CHECK(!patcher.setString({ 1 }, "wrong wire type"));
+
+   // Lengths and values running past the end of the buffer or of their
+   // enclosing message fail and leave the buffer as it was
+   auto check = [](std::string malformed, bool (*patch)(pbsl::Patcher &)) {
+      auto original = malformed;
+      auto malformedPatcher = pbsl::Patcher { malformed };
+      CHECK(!patch(malformedPatcher));
+      CHECK(malformed == original);
+   };
+
+   check(std::string("\x12\x64", 2) + std::string(20, 'x'), [](pbsl::Patcher &p) { return p.setUint32({ 1 }, 5); });
+   check(std::string("\x08\x01\x15\x01", 4), [](pbsl::Patcher &p) { return p.setFixed32({ 2 }, 7); });
+   check(std::string("\x08\x01\x15\x01", 4), [](pbsl::Patcher &p) { return p.setUint32({ 3 }, 7); });
+   check(std::string("\x08", 1), [](pbsl::Patcher &p) { return p.setUint32({ 1 }, 7); });
+   check(std::string("\x12\x02\x15\x01\x08\x01", 6), [](pbsl::Patcher &p) { return p.setFixed32({ 2, 2 }, 7); });
+   check(std::string("\x12\x02\x0a\x05\x08\x01", 6), [](pbsl::Patcher &p) { return p.setUint32({ 2, 1, 1 }, 7); });
+}
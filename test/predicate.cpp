@@ -0,0 +1,86 @@
+#include <pbsl/predicate.h>
+#include <pbsl/writer.h>
+#include <cstring>
+#include <vector>
+#include "test.h"
+
+void testPredicate()
+{
+   // Field 1 occurs twice, a decoded message keeps the last one. Field 2 is
+   // a sub message occurring twice, which parse() merges, its field 3 is
+   // repeated.
+   auto first = std::string {};
+   auto firstWriter = pbsl::Writer { first };
+   firstWriter.writeTag(3, pbsl::Parser::WireType::VarInt);
+   firstWriter.writeUint32(7);
+   firstWriter.writeTag(3, pbsl::Parser::WireType::VarInt);
+   firstWriter.writeUint32(8);
+
+   auto second = std::string {};
+   auto secondWriter = pbsl::Writer { second };
+   secondWriter.writeTag(3, pbsl::Parser::WireType::VarInt);
+   secondWriter.writeUint32(9);
+
+   auto record = std::string {};
+   auto writer = pbsl::Writer { record };
+   writer.writeTag(1, pbsl::Parser::WireType::VarInt);
+   writer.writeInt32(5);
+   writer.writeTag(2, pbsl::Parser::WireType::LengthDelimited);
+   writer.writeBytes(first);
+   writer.writeTag(1, pbsl::Parser::WireType::VarInt);
+   writer.writeInt32(6);
+   writer.writeTag(2, pbsl::Parser::WireType::LengthDelimited);
+   writer.writeBytes(second);
+
+   auto check = [&](const char *expression, bool expected) {
+      auto predicate = pbsl::Predicate {};
+      CHECK(predicate.parse(expression));
+      CHECK(predicate.evaluate(record) == expected);
+   };
+
+   // Scalars compare by their last occurrence
+   check("1 == 6", true);
+   check("1 == 5", false);
+   check("any(1) == 5", true);
+   check("2.3 == 9", true);
+   check("2.3 == 7", false);
+
+   // Repeated fields match on any element, across merged sub messages too
+   check("any(2.3) == 7", true);
+   check("any(2.3) == 9", true);
+   check("any(2.3) > 9", false);
+
+   // Absent scalars compare as their default, absent repeated fields match
+   // nothing
+   check("4 == 0", true);
+   check("any(4) == 0", false);
+   check("has(2.3) && !has(4)", true);
+
+   auto built = pbsl::Predicate { pbsl::fieldAt({ 1 }) == 6 && pbsl::fieldAt({ 2, 3 }).any() == 8 };
+   CHECK(built.evaluate(record));
+
+   // Truncated records match nothing, whatever the predicate, and are not
+   // read past their end. Each is copied to a buffer of its own size.
+   auto checkTruncated = [](const char *bytes, std::initializer_list<const char *> expressions) {
+      auto copy = std::vector<char>(bytes, bytes + strlen(bytes));
+      auto view = std::string_view { copy.data(), copy.size() };
+
+      for (auto expression : expressions) {
+         auto predicate = pbsl::Predicate {};
+         CHECK(predicate.parse(expression));
+         CHECK(!predicate.evaluate(view));
+      }
+   };
+
+   const char *truncated[] = { "\x08", "\x08\x80", "\x0d\x01\x02", "\x09\x01", "\x12\x05\x18\x01", "\x88" };
+
+   for (auto bytes : truncated) {
+      checkTruncated(bytes, { "1 == 0", "!(1 == 1)", "any(2.3) == 1", "!has(2.3)", "4 == 0 || 1 == 0" });
+   }
+
+   // A sub message is only looked into by paths that descend into it
+   checkTruncated("\x12\x02\x18\x80", { "2.3 == 0", "any(2.3) == 1", "!has(2.3)" });
+
+   auto invalid = pbsl::Predicate {};
+   CHECK(!invalid.parse("any(1 == 2"));
+}
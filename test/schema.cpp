@@ -0,0 +1,46 @@
+#include <pbsl/schema.h>
+#include <pbsl/writer.h>
+#include "test.h"
+
+struct Flags
+{
+   std::vector<bool> bits;
+   std::vector<int32_t> values;
+};
+
+using FlagsSchema = pbsl::Schema<
+   pbsl::Field<1, PBSL_MEMBER(&Flags::bits)>,
+   pbsl::Field<2, PBSL_MEMBER(&Flags::values)>>;
+
+void testSchema()
+{
+   auto packed = std::string {};
+   auto packedWriter = pbsl::Writer { packed };
+   packedWriter.writeBool(false);
+   packedWriter.writeBool(true);
+
+   // Repeated bool, which std::vector<bool> stores as bits, unpacked and
+   // then packed
+   auto buffer = std::string {};
+   auto writer = pbsl::Writer { buffer };
+   writer.writeTag(1, pbsl::Parser::WireType::VarInt);
+   writer.writeBool(true);
+   writer.writeTag(2, pbsl::Parser::WireType::VarInt);
+   writer.writeInt32(-3);
+   writer.writeTag(1, pbsl::Parser::WireType::LengthDelimited);
+   writer.writeBytes(packed);
+
+   auto flags = Flags {};
+   CHECK(FlagsSchema::parse(buffer, flags));
+   CHECK(flags.bits == std::vector<bool>({ true, false, true }));
+   CHECK(flags.values == std::vector<int32_t>({ -3 }));
+
+   // A bool with the wrong wire type fails instead of reading garbage
+   auto invalid = std::string {};
+   auto invalidWriter = pbsl::Writer { invalid };
+   invalidWriter.writeTag(1, pbsl::Parser::WireType::Fixed32);
+   invalidWriter.writeFixed32(1);
+
+   auto failed = Flags {};
+   CHECK(!FlagsSchema::parse(invalid, failed));
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <iostream>
+
+// Minimal checks for the runtime headers, every failed check is printed and
+// makes the test program exit with a non-zero status
+extern int CheckFailures;
+
+#define CHECK(condition) \
+   do { \
+      if (!(condition)) { \
+         std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+         CheckFailures++; \
+      } \
+   } while (0)
+
+void testPatcher();
+void testIntern();
+void testSchema();
+void testDynamic();
+void testPredicate();
+void testBatch();
+void testWriter();
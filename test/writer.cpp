@@ -0,0 +1,59 @@
+#include <pbsl/writer.h>
+#include "test.h"
+
+static std::string joinSegments(const std::vector<pbsl::IoVec> &segments)
+{
+   auto joined = std::string {};
+
+   for (auto &segment : segments) {
+      joined.append(static_cast<const char *>(segment.iov_base), segment.iov_len);
+   }
+
+   return joined;
+}
+
+static void writeRecord(pbsl::Writer &writer, uint32_t id, const std::string &payload)
+{
+   writer.writeTag(1, pbsl::Parser::WireType::VarInt);
+   writer.writeUint32(id);
+   writer.writeTag(2, pbsl::Parser::WireType::LengthDelimited);
+   writer.writeString(payload);
+}
+
+void testWriter()
+{
+   auto payload = std::string(600, 'p');
+
+   // Records copied into one buffer, to compare the gathered ones with
+   auto expected = std::string {};
+   auto copier = pbsl::Writer { expected };
+
+   for (auto id = 0u; id < 100; ++id) {
+      writeRecord(copier, id, payload);
+   }
+
+   // Many records through one gather writer, the scratch buffer reallocates
+   // many times, also after the first finish(), the last one points every
+   // scratch segment at where it ended up
+   auto scratch = std::string { "earlier" };
+   auto segments = std::vector<pbsl::IoVec> {};
+   auto gatherer = pbsl::Writer { scratch, segments, 512 };
+
+   for (auto id = 0u; id < 100; ++id) {
+      writeRecord(gatherer, id, payload);
+
+      if (id == 10) {
+         gatherer.finish();
+      }
+   }
+
+   gatherer.finish();
+   CHECK(joinSegments(segments) == expected);
+   CHECK(gatherer.size() == expected.size());
+
+   // Bytes already in the buffer are not counted
+   auto buffer = std::string { "prefix" };
+   auto writer = pbsl::Writer { buffer };
+   writeRecord(writer, 1, "x");
+   CHECK(writer.size() == buffer.size() - 6);
+}